@@ -1,15 +1,32 @@
+#include <miscellaneous/Benchmark.h>
+#include <miscellaneous/Cpu.h>
+#include <miscellaneous/EvalBatch.h>
 #include <representation/AttackTables.h>
 #include <miscellaneous/FenParser.h>
 #include <search/NNUE.h>
 #include <search/ZobristKey.h>
 #include <miscellaneous/UCI.h>
 
-int main() {
+int main(int argc, char** argv) {
     {
         PROFILE_SCOPE("Program");
+        ChessEngine::Cpu::DetectFeatures();
         ChessEngine::AttackTables::InitMoveTables();
         ChessEngine::NNUE::InitModel("nn-62ef826d1a6d.nnue");
         ChessEngine::Zobrist::InitZobristKeysArrays();
+
+        // Non interactive modes: MyEngine evalbatch [threads <n>] [file <path>]
+        //                        MyEngine bench <name> [iterations]
+        std::vector<std::string> args(argv + 1, argv + argc);
+        if(!args.empty() && args[0] == "evalbatch"){
+            ChessEngine::EvalBatch::Run(args);
+            return 0;
+        }
+        if(!args.empty() && args[0] == "bench"){
+            ChessEngine::Benchmark::Run(args);
+            return 0;
+        }
+
         ChessEngine::UCI::MainLoop();
     }
 
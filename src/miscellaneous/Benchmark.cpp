@@ -0,0 +1,318 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <miscellaneous/FenParser.h>
+#include <representation/AttackTables.h>
+#include <search/MCTS.h>
+#include <search/Playout.h>
+#include <search/Search.h>
+#ifdef ABSOLUTE_BOARD
+#include <representation/AbsoluteBoard.h>
+#endif
+
+namespace ChessEngine::Benchmark{
+
+    namespace {
+
+        struct SliderQuery{
+            uint8_t tile_index;
+            Bitboard occupancies;
+        };
+
+        // Deterministic xorshift so runs are comparable.
+        uint64_t NextRandom(uint64_t& state){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+        std::vector<SliderQuery> SliderQueries(){
+            std::vector<SliderQuery> queries(4096);
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            for (auto& query : queries) {
+                query.tile_index = NextRandom(state) % 64;
+                // Sparse occupancies, closer to real positions.
+                query.occupancies = Bitboard(NextRandom(state) & NextRandom(state));
+            }
+            return queries;
+        }
+
+        // Returns nanoseconds per lookup. [checksum] keeps the lookups from being optimised away.
+        double TimeSliders(const std::vector<SliderQuery>& queries, int iterations, uint64_t& checksum){
+            checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                for (const auto& query : queries) {
+                    checksum += AttackTables::RookAttacks(query.tile_index, query.occupancies).AsInt();
+                    checksum ^= AttackTables::BishopAttacks(query.tile_index, query.occupancies).AsInt();
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            return ns / (2.0 * iterations * queries.size());
+        }
+
+        // Times [primitive] over [boards]. Returns nanoseconds per call.
+        template <typename Primitive>
+        double TimePrimitive(const std::vector<uint64_t>& boards, int iterations, Primitive primitive, uint64_t& checksum){
+            checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                for (uint64_t board : boards)
+                    checksum += primitive(board);
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            return ns / ((double)iterations * boards.size());
+        }
+
+        void PrintComparison(const std::string& name, double portable_ns, double builtin_ns, bool same_result){
+            std::cout << name << " : portable " << portable_ns << " ns/call, builtin " << builtin_ns << " ns/call"
+                      << (same_result ? "" : " (MISMATCH)") << std::endl;
+        }
+
+        void BenchBitboard(int iterations){
+            std::vector<uint64_t> boards(4096);
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            for (auto& board : boards)
+                board = (NextRandom(state) & NextRandom(state)) | 1; // Never empty, for the bit scans.
+
+            // Lambdas, so every primitive is inlined into its own timing loop.
+            uint64_t portable_checksum, builtin_checksum;
+            double portable_ns = TimePrimitive(boards, iterations, [](uint64_t board){ return BitOps::PortablePopCount(board); }, portable_checksum);
+            double builtin_ns = TimePrimitive(boards, iterations, [](uint64_t board){ return BitOps::PopCount(board); }, builtin_checksum);
+            PrintComparison("count", portable_ns, builtin_ns, portable_checksum == builtin_checksum);
+
+            portable_ns = TimePrimitive(boards, iterations, [](uint64_t board){ return BitOps::PortableLowestBit(board); }, portable_checksum);
+            builtin_ns = TimePrimitive(boards, iterations, [](uint64_t board){ return BitOps::LowestBit(board); }, builtin_checksum);
+            PrintComparison("bitscan", portable_ns, builtin_ns, portable_checksum == builtin_checksum);
+        }
+
+        void BenchSliders(int iterations){
+            auto queries = SliderQueries();
+            auto original_backend = AttackTables::GetSliderBackend();
+
+            const std::pair<AttackTables::SliderBackend, std::string> backends[] = {
+                {AttackTables::SliderBackend::Magic, "magic"},
+                {AttackTables::SliderBackend::Pext, "pext"},
+            };
+
+            uint64_t reference = 0;
+            for (const auto& [backend, name] : backends) {
+                if (!AttackTables::SetSliderBackend(backend)) {
+                    std::cout << name << " : not supported" << std::endl;
+                    continue;
+                }
+
+                uint64_t checksum;
+                double ns = TimeSliders(queries, iterations, checksum);
+                if (reference == 0)
+                    reference = checksum;
+                std::cout << name << " : " << ns << " ns/lookup" << (checksum == reference ? "" : " (MISMATCH)") << std::endl;
+            }
+
+            AttackTables::SetSliderBackend(original_backend);
+        }
+
+        struct PerftPosition{
+            std::string fen;
+            int depth;
+            int nodes;
+        };
+
+        // Positions with known node counts covering castling, en passant, promotions and pins.
+        const PerftPosition perft_positions[] = {
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+                {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+                {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+                {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+                {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333},
+                {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+                {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+        };
+
+        // Returns the nodes of [perft] and its time in milliseconds.
+        template <typename Representation>
+        std::pair<int, double> TimePerft(const Representation& board, int depth){
+            auto start = std::chrono::steady_clock::now();
+            int nodes = Perft(board, depth);
+            auto end = std::chrono::steady_clock::now();
+            return {nodes, std::chrono::duration<double, std::milli>(end - start).count()};
+        }
+
+        // Runs the perft suite on Board and, when built with ABSOLUTE_BOARD, on AbsoluteBoard.
+        // [depth] overrides the depth of every position, the known node counts are then not checked.
+        void BenchPerft(int depth){
+            bool passed = true;
+            for (const auto& position : perft_positions) {
+                Board::BoardInfo info;
+                if (!ParseFenString(position.fen, info)) {
+                    std::cout << "[ERROR] Invalid fen " << position.fen << std::endl;
+                    passed = false;
+                    continue;
+                }
+                Board board(info);
+                int position_depth = depth > 0 ? depth : position.depth;
+
+                auto [nodes, ms] = TimePerft(board, position_depth);
+                bool correct = depth > 0 || nodes == position.nodes;
+                std::cout << position.fen << " depth " << position_depth << std::endl;
+                std::cout << "  board : " << nodes << " nodes " << ms << " ms" << (correct ? "" : " (WRONG)") << std::endl;
+                passed &= correct;
+
+#ifdef ABSOLUTE_BOARD
+                auto [absolute_nodes, absolute_ms] = TimePerft(AbsoluteBoard(board), position_depth);
+                bool same_nodes = absolute_nodes == nodes;
+                std::cout << "  absolute board : " << absolute_nodes << " nodes " << absolute_ms << " ms"
+                          << (same_nodes ? "" : " (MISMATCH)") << std::endl;
+                passed &= same_nodes;
+#endif
+            }
+            std::cout << "perft " << (passed ? "OK" : "FAILED") << std::endl;
+        }
+
+        // Non empty buckets of a power of 2 histogram.
+        void PrintHistogram(const std::string& name, const std::array<uint64_t, 32>& histogram){
+            std::cout << "  " << name << " :";
+            for (int bucket = 0; bucket < 32; bucket++) {
+                if (histogram[bucket])
+                    std::cout << " [" << (1ull << bucket) << "] " << histogram[bucket];
+            }
+            std::cout << std::endl;
+        }
+
+        // Random game played through Board , the reference of the playout benchmark.
+        int BoardRandomGame(Board board, int max_plies, uint64_t& random_state){
+            int ply = 0;
+            for (; ply < max_plies; ply++) {
+                MoveList moves = board.GetLegalMoves();
+                if (board.Result(moves) != GameResult::Playing)
+                    break;
+                board.PlayMove(moves[NextRandom(random_state) % moves.size()]);
+                board.Mirror();
+            }
+            return ply;
+        }
+
+        void BenchPlayout(int iterations){
+            std::vector<Board> boards;
+            bool passed = true;
+            for (const auto& position : perft_positions) {
+                Board::BoardInfo info;
+                ParseFenString(position.fen, info);
+                boards.emplace_back(info);
+
+                // The playout generates and tests moves on its own.
+                uint64_t nodes = Playout::Perft(boards.back(), 3);
+                if (nodes != uint64_t(Perft(boards.back(), 3))) {
+                    std::cout << "[ERROR] Playout perft mismatch " << position.fen << std::endl;
+                    passed = false;
+                }
+            }
+            std::cout << "playout perft " << (passed ? "OK" : "FAILED") << std::endl;
+
+            auto report = [&](const std::string& name, double ms, uint64_t plies) {
+                std::cout << name << " : " << iterations << " playouts " << ms << " ms ("
+                          << iterations / (ms / 1000.0) << " playouts/s, " << plies / (ms / 1000.0) << " plies/s)" << std::endl;
+            };
+
+            uint64_t random_state = 0x9E3779B97F4A7C15ull;
+            uint64_t plies = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                plies += BoardRandomGame(boards[i % boards.size()], PLAYOUT_MAX_PLIES, random_state);
+            }
+            auto end = std::chrono::steady_clock::now();
+            report("board", std::chrono::duration<double, std::milli>(end - start).count(), plies);
+
+            plies = 0;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                int game_plies;
+                Playout::RandomGame(boards[i % boards.size()], PLAYOUT_MAX_PLIES, &game_plies);
+                plies += game_plies;
+            }
+            end = std::chrono::steady_clock::now();
+            report("playout", std::chrono::duration<double, std::milli>(end - start).count(), plies);
+        }
+
+        // Monte Carlo search of the start position with 1, 2, 4 ... [threads] threads.
+        // A small [tree_mb] makes the tree recycle its subtrees.
+        void BenchMCTS(int iterations, int tree_mb, int threads, const MCTS::Options& base_options){
+            Board::BoardInfo info;
+            ParseFenString(perft_positions[0].fen, info);
+            Board board(info);
+
+            double single_thread_rate = 0;
+            for (int thread_count = 1; ; thread_count = std::min(2 * thread_count, threads)) {
+                MCTS::Options options = base_options;
+                options.threads = thread_count;
+                options.tree_mb = tree_mb;
+                MCTS::Stats stats;
+                auto start = std::chrono::steady_clock::now();
+                Move best_move = MCTS::Search(board, iterations, options, &stats);
+                auto end = std::chrono::steady_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(end - start).count();
+                double rate = stats.iterations / (ms / 1000.0);
+                if (thread_count == 1)
+                    single_thread_rate = rate;
+
+                std::cout << "mcts " << thread_count << " threads : " << stats.iterations << " iterations " << ms << " ms ("
+                          << rate << " iterations/s, x" << rate / single_thread_rate << ")" << std::endl;
+                std::cout << "  tree : " << stats.tree_nodes << " nodes " << stats.recycles << " recycles" << std::endl;
+                if (options.shared_mb > 0) {
+                    std::cout << "  shared : " << stats.shared_entries << " positions " << stats.shared_hits
+                              << " transpositions" << std::endl;
+                }
+                std::cout << "  best move : " << best_move.AlgebraicNotation(board.IsFlipped()) << std::endl;
+                if (options.batch_size > 0) {
+                    PrintHistogram("batch sizes", stats.batch_size_histogram);
+                    PrintHistogram("latencies (us)", stats.latency_histogram);
+                }
+                if (thread_count >= threads)
+                    break;
+            }
+        }
+    }
+
+    void Run(const std::vector<std::string>& args){
+        if (args.size() < 2) {
+            std::cout << "[ERROR] Missing benchmark name" << std::endl;
+            return;
+        }
+
+        if (args[1] == "perft") {
+            BenchPerft(args.size() > 2 ? atoi(args[2].c_str()) : 0);
+            return;
+        }
+
+        int iterations = args.size() > 2 ? std::max(1, atoi(args[2].c_str())) : 1000;
+        if (args[1] == "sliders") {
+            BenchSliders(iterations);
+        } else if (args[1] == "bitboard") {
+            BenchBitboard(iterations);
+        } else if (args[1] == "playout") {
+            BenchPlayout(iterations);
+        } else if (args[1] == "mcts") {
+            MCTS::Options options;
+            if (args.size() > 5 && !MCTS::ParseLeafEvaluation(args[5], options.leaf_evaluation)) {
+                std::cout << "[ERROR] Unknown leaf evaluation " << args[5] << std::endl;
+                return;
+            }
+            if (args.size() > 6)
+                options.batch_size = std::max(0, atoi(args[6].c_str()));
+            if (args.size() > 7)
+                options.queue_depth = std::max(1, atoi(args[7].c_str()));
+            if (args.size() > 8)
+                options.shared_mb = std::max(0, atoi(args[8].c_str()));
+            BenchMCTS(iterations, args.size() > 3 ? std::max(1, atoi(args[3].c_str())) : MCTS_TREE_MB,
+                      args.size() > 4 ? std::max(1, atoi(args[4].c_str())) : 1, options);
+        } else {
+            std::cout << "[ERROR] Unknown benchmark " << args[1] << std::endl;
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+namespace ChessEngine::Benchmark{
+    // Micro benchmarks of the engine's hot primitives: MyEngine bench <name> [iterations]
+    // Names: sliders (magic vs pext slider lookups), bitboard (portable vs builtin bit primitives).
+    //        perft [depth] (move generation suite, compared against AbsoluteBoard when built with ABSOLUTE_BOARD).
+    //        mcts [iterations] [tree mb] [threads] [leaf evaluation] [batch size] [queue depth] [shared mb] (Monte Carlo
+    //        search of the start position, scaling up to [threads]. Leaf evaluations: rollout, eval, qsearch (default), playout).
+    //        playout [iterations] (playout move generation checked against perft, random games per second of the fast
+    //        playout vs games played through Board).
+    void Run(const std::vector<std::string>& args);
+}
+
+#endif
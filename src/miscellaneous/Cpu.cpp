@@ -0,0 +1,76 @@
+#include "Cpu.h"
+
+namespace ChessEngine::Cpu {
+
+    namespace {
+        SimdLevel simd_level = SimdLevel::Default;
+        bool has_bmi2 = false;
+        bool has_fast_pext = false;
+        bool has_vnni = false;
+    }
+
+    void DetectFeatures(){
+    #ifdef CPU_DISPATCH
+        // Fills the cpu model data read through cpuid.
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512bw"))
+            simd_level = SimdLevel::AVX512;
+        else if(__builtin_cpu_supports("avx2"))
+            simd_level = SimdLevel::AVX2;
+        else if(__builtin_cpu_supports("sse4.1"))
+            simd_level = SimdLevel::SSE41;
+        else if(__builtin_cpu_supports("sse2"))
+            simd_level = SimdLevel::SSE2;
+
+        has_bmi2 = __builtin_cpu_supports("bmi2");
+        has_fast_pext = has_bmi2 && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+        has_vnni = __builtin_cpu_supports("avx512vnni");
+    #endif
+    }
+
+    SimdLevel GetSimdLevel(){
+        return simd_level;
+    }
+
+    bool HasBMI2(){
+        return has_bmi2;
+    }
+
+    bool HasFastPEXT(){
+        return has_fast_pext;
+    }
+
+    bool HasVNNI(){
+        return has_vnni;
+    }
+
+    std::string Description(){
+        std::string description;
+        switch (simd_level) {
+            case SimdLevel::Default:
+                description = "default";
+                break;
+            case SimdLevel::SSE2:
+                description = "sse2";
+                break;
+            case SimdLevel::SSE41:
+                description = "sse4.1";
+                break;
+            case SimdLevel::AVX2:
+                description = "avx2";
+                break;
+            case SimdLevel::AVX512:
+                description = "avx512";
+                break;
+        }
+
+        if(has_vnni)
+            description += " vnni";
+        if(has_bmi2)
+            description += " bmi2";
+        if(has_fast_pext)
+            description += " pext";
+        return description;
+    }
+
+}
@@ -0,0 +1,36 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <string>
+
+// Kernels are compiled for several instruction sets through target attributes
+// and the best one supported by the running cpu is picked at startup.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_DISPATCH
+#define TARGET_ISA(isa) __attribute__((target(isa)))
+#define FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define TARGET_ISA(isa)
+#define FORCE_INLINE inline
+#endif
+
+namespace ChessEngine::Cpu {
+
+    // Ordered from the least to the most capable.
+    enum class SimdLevel{
+        Default, SSE2, SSE41, AVX2, AVX512
+    };
+
+    void DetectFeatures();
+
+    SimdLevel GetSimdLevel();
+    bool HasBMI2();
+    // Pext is microcoded (slow) on amd cpus before zen 3.
+    bool HasFastPEXT();
+    bool HasVNNI();
+
+    // Short description of the picked kernels, used for the info string output.
+    std::string Description();
+}
+
+#endif
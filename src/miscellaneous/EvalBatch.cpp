@@ -0,0 +1,90 @@
+#include "EvalBatch.h"
+
+#include <fstream>
+#include <iostream>
+
+#include <miscellaneous/FenParser.h>
+#include <search/NNUE.h>
+
+#define EVAL_BATCH_BLOCK_SIZE 4096 // Lines read, parsed and evaluated at once.
+
+namespace ChessEngine::EvalBatch{
+
+    namespace {
+
+        void ProcessBlock(const std::vector<std::string>& lines, int threads){
+            int count = (int)lines.size();
+            std::vector<Board> boards(count);
+            std::vector<uint8_t> is_valid(count);
+
+            ParallelFor(count, threads, [&](int begin, int end){
+                for(int i = begin; i < end; i++){
+                    Board::BoardInfo info = {};
+                    is_valid[i] = ParseFenString(lines[i], info);
+                    if(is_valid[i])
+                        boards[i] = Board(info);
+                }
+            });
+
+            // Evaluate valid positions contiguously.
+            int valid_count = 0;
+            for(int i = 0; i < count; i++){
+                if(is_valid[i])
+                    boards[valid_count++] = boards[i];
+            }
+
+            std::vector<int> scores(valid_count);
+            NNUE::EvaluateBatch(boards.data(), valid_count, scores.data(), threads);
+
+            std::string output;
+            int score_index = 0;
+            for(int i = 0; i < count; i++){
+                output += is_valid[i] ? std::to_string(scores[score_index++]) : "invalid";
+                output += '\n';
+            }
+            std::cout << output << std::flush;
+        }
+
+        void Stream(std::istream& input, int threads){
+            std::vector<std::string> lines;
+            lines.reserve(EVAL_BATCH_BLOCK_SIZE);
+
+            std::string line;
+            while(std::getline(input, line)){
+                if(!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                lines.push_back(line);
+                if(lines.size() == EVAL_BATCH_BLOCK_SIZE){
+                    ProcessBlock(lines, threads);
+                    lines.clear();
+                }
+            }
+
+            if(!lines.empty())
+                ProcessBlock(lines, threads);
+        }
+    }
+
+    void Run(const std::vector<std::string>& args){
+        int threads = 1;
+        std::string file_name;
+        for(size_t i = 0; i + 1 < args.size(); i++){
+            if(args[i] == "threads")
+                threads = std::max(1, atoi(args[i + 1].c_str()));
+            else if(args[i] == "file")
+                file_name = args[i + 1];
+        }
+
+        if(file_name.empty()){
+            Stream(std::cin, threads);
+            return;
+        }
+
+        std::ifstream file(file_name);
+        if(!file.is_open()){
+            std::cerr << "[ERROR] Could not open " << file_name << std::endl;
+            return;
+        }
+        Stream(file, threads);
+    }
+}
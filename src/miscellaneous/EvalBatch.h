@@ -0,0 +1,14 @@
+#ifndef EVAL_BATCH_H
+#define EVAL_BATCH_H
+
+#include <string>
+#include <vector>
+
+namespace ChessEngine::EvalBatch{
+    // Streams fen strings (one per line) from stdin, or from a file given as [file <path>],
+    // and prints the NNUE score of each from the side to move's point of view.
+    // Lines that are not valid fens print "invalid". [threads <n>] sets the worker count.
+    void Run(const std::vector<std::string>& args);
+}
+
+#endif
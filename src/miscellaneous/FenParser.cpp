@@ -172,7 +172,9 @@ namespace ChessEngine {
                 return false;
 
             auto[file, rank] = coords;
-            if (rank != Rank::R3 && rank != Rank::R8)
+            // Black's double push (rank 6) leaves the flag on white's rank 8, white's (rank 3) on rank 1
+            // which becomes rank 8 once the board is mirrored for black.
+            if (rank != Rank::R3 && rank != Rank::R6)
                 return false;
             Rank new_rank = (rank == Rank::R3) ? Rank::R1 : Rank::R8;
             representation.pawns_enPassant.Set(file, new_rank);
@@ -157,12 +157,12 @@ namespace ChessEngine::MagicNumbers {
                     { 0x0001ffff9dffa333u,  14826 }
             };
 
-    uint64_t BishopMagicHash(Bitboard board, uint8_t square_index){
+    constexpr uint64_t BishopMagicHash(Bitboard board, uint8_t square_index){
         auto square_info = bishopMagics[square_index];
         return ((board.AsInt() * square_info.magic_number) >> (64 - bishopBitOffset)) + square_info.main_table_offset;
     }
 
-    uint64_t RookMagicHash(Bitboard board, uint8_t square_index){
+    constexpr uint64_t RookMagicHash(Bitboard board, uint8_t square_index){
         auto square_info = rookMagics[square_index];
         return ((board.AsInt() * square_info.magic_number) >> (64 - rook_bit_offset)) + square_info.main_table_offset;
     }
@@ -1,12 +1,26 @@
 #include "UCI.h"
 
+#include <miscellaneous/Cpu.h>
 #include <miscellaneous/FenParser.h>
+#include <search/MCTS.h>
+#include <search/ProofNumber.h>
 #include <search/Search.h>
 
+#include <cmath>
+
 namespace ChessEngine::UCI{
 
     namespace {
 
+        enum class SearchMode{
+            AlphaBeta,
+            MCTS
+        };
+
+        struct Settings{
+            SearchMode search_mode = SearchMode::AlphaBeta;
+        };
+
         bool FindWord(const std::vector<std::string>& words, std::string word, int& index){
             int i = 0;
             bool found = false;
@@ -28,8 +42,13 @@ namespace ChessEngine::UCI{
             // ID.
             std::cout << "id name " << name << std::endl;
             std::cout << "id author " << author << std::endl;
+            std::cout << "info string simd " << Cpu::Description() << std::endl;
 
             // Options.
+            std::cout << "option name SearchMode type combo default AlphaBeta var AlphaBeta var MCTS" << std::endl;
+            std::cout << "option name Threads type spin default 1 min 1 max 256" << std::endl;
+            std::cout << "option name MCTSLeaf type combo default qsearch var rollout var eval var qsearch var playout" << std::endl;
+            std::cout << "option name MCTSHash type spin default 0 min 0 max 4096" << std::endl;
 
             // Done.
             std::cout << "uciok" << std::endl;
@@ -58,7 +77,12 @@ namespace ChessEngine::UCI{
                 // Skip moves word.
                 iter++;
                 for (; iter != words.end(); iter++) {
-                    Move move(*iter, board.IsFlipped());
+                    // Uci moves only hold from, to and promotion.
+                    Move move;
+                    if (!board.FindLegalMove(Move(*iter, board.IsFlipped()).Compress(), move)) {
+                        std::cout << "[ERROR] Illegal move " << *iter << std::endl;
+                        break;
+                    }
                     board.PlayMove(move);
                     board.Mirror();
                 }
@@ -67,6 +91,138 @@ namespace ChessEngine::UCI{
             return board;
         }
 
+        // setoption name <name> value <value>
+        void CommandSetOption(const std::vector<std::string> &words, Settings& settings, MCTS::Searcher& searcher) {
+            int name_index, value_index;
+            if(!FindWord(words, "name", name_index) || !FindWord(words, "value", value_index) ||
+               size_t(name_index + 1) >= words.size() || size_t(value_index + 1) >= words.size()){
+                std::cout << "[ERROR] Expected setoption name <name> value <value>" << std::endl;
+                return;
+            }
+
+            const std::string& name = words[name_index + 1];
+            const std::string& value = words[value_index + 1];
+            MCTS::Options options = searcher.GetOptions();
+            if(name == "SearchMode"){
+                if(value == "AlphaBeta"){
+                    settings.search_mode = SearchMode::AlphaBeta;
+                }else if(value == "MCTS"){
+                    settings.search_mode = SearchMode::MCTS;
+                }else{
+                    std::cout << "[ERROR] Unknown search mode " << value << std::endl;
+                }
+            }else if(name == "Threads"){
+                options.threads = std::max(1, atoi(value.c_str()));
+            }else if(name == "MCTSLeaf"){
+                if(!MCTS::ParseLeafEvaluation(value, options.leaf_evaluation))
+                    std::cout << "[ERROR] Unknown leaf evaluation " << value << std::endl;
+            }else if(name == "MCTSHash"){
+                options.shared_mb = std::max(0, atoi(value.c_str()));
+            }else{
+                std::cout << "[ERROR] Unknown option " << name << std::endl;
+            }
+            searcher.SetOptions(options);
+        }
+
+        // Expected result between -1 and 1 back to centipawns, the inverse of the leaf score mapping.
+        int ValueToCentipawns(float value){
+            float p = std::clamp((value + 1) / 2, 0.001f, 0.999f);
+            return int(std::round(MCTS_SCORE_SCALE * std::log(p / (1 - p))));
+        }
+
+        // A proven root is scored in moves to mate along its line , only unproven values in centipawns.
+        std::string MCTSScore(const MCTS::Stats& stats){
+            switch(stats.proof){
+                case MCTS::Proof::Win:
+                    return "mate " + std::to_string((stats.best_line.size() + 1) / 2);
+                case MCTS::Proof::Loss:
+                    return "mate " + std::to_string(-int(stats.best_line.size() / 2));
+                case MCTS::Proof::Draw:
+                    return "cp 0";
+                case MCTS::Proof::None:
+                    break;
+            }
+            return "cp " + std::to_string(ValueToCentipawns(stats.value));
+        }
+
+        void PrintMCTSInfo(const MCTS::Stats& stats, const Board &board) {
+            std::cout << "info nodes " << stats.iterations << " nps " << int64_t(stats.iterations) * 1000 / std::max(stats.time_ms, 1)
+                      << " time " << stats.time_ms << " score " << MCTSScore(stats) << " pv";
+            bool is_flipped = board.IsFlipped();
+            for(const auto& move : stats.best_line){
+                std::cout << " " << move.AlgebraicNotation(is_flipped);
+                is_flipped = !is_flipped;
+            }
+            std::cout << std::endl;
+        }
+
+        // Value following [word] , false if the word or its value is missing.
+        bool FindValue(const std::vector<std::string>& words, const std::string& word, int& value){
+            int index;
+            if(!FindWord(words, word, index) || size_t(index + 1) >= words.size())
+                return false;
+            value = atoi(words[index + 1].c_str());
+            return true;
+        }
+
+        // go nodes <n> | movetime <ms> | wtime <ms> btime <ms> [winc <ms> binc <ms>]
+        // Missing values leave the default limits.
+        void CommandGoMCTS(const std::vector<std::string> &words, const Board &board, MCTS::Searcher& searcher) {
+            MCTS::Limits limits;
+            FindValue(words, "nodes", limits.iterations);
+            int time;
+            if(!FindValue(words, "movetime", limits.time_ms) && FindValue(words, board.IsFlipped() ? "btime" : "wtime", time)){
+                // Spend a share of the remaining time and half the increment.
+                int increment = 0;
+                FindValue(words, board.IsFlipped() ? "binc" : "winc", increment);
+                limits.time_ms = std::max(1, time / 30 + increment / 2);
+            }
+
+            MCTS::Stats stats;
+            Move best_move = searcher.Search(board, limits, &stats, [&](const MCTS::Stats& info){
+                PrintMCTSInfo(info, board);
+            });
+            PrintMCTSInfo(stats, board);
+            // No move is searched once the game is over.
+            std::cout << "bestmove " << (stats.best_line.empty() ? "0000" : best_move.AlgebraicNotation(board.IsFlipped())) << std::endl;
+        }
+
+        // go mate <moves> [nodes <n>] , whatever the search mode.
+        void CommandGoMate(const std::vector<std::string> &words, const Board &board, int mate_index) {
+            if(size_t(mate_index + 1) >= words.size()){
+                std::cout << "[ERROR] Expected go mate <moves>" << std::endl;
+                return;
+            }
+            int moves = std::clamp(atoi(words[mate_index + 1].c_str()), 1, PN_MAX_MOVES);
+            uint64_t max_nodes = 0;
+            int index;
+            if(FindWord(words, "nodes", index) && size_t(index + 1) < words.size()){
+                max_nodes = strtoull(words[index + 1].c_str(), nullptr, 10);
+            }
+
+            std::vector<Move> line;
+            ProofNumber::Stats stats;
+            int mate_length = ProofNumber::FindMate(board, moves, line, max_nodes, &stats);
+            if(mate_length == 0){
+                std::cout << "info nodes " << stats.nodes << " time " << stats.time_ms << std::endl;
+                std::cout << "info string no mate in " << moves << " found" << std::endl;
+                std::cout << "bestmove 0000" << std::endl;
+                return;
+            }
+
+            // The line may be cut short by replaced table entries , the score is the proven length.
+            std::cout << "info depth " << 2 * mate_length - 1 << " nodes " << stats.nodes << " nps "
+                      << int64_t(stats.nodes) * 1000 / std::max(stats.time_ms, 1) << " time " << stats.time_ms
+                      << " score mate " << mate_length << " pv";
+            bool is_flipped = board.IsFlipped();
+            for(const auto& move : line){
+                std::cout << " " << move.AlgebraicNotation(is_flipped);
+                is_flipped = !is_flipped;
+            }
+            std::cout << std::endl;
+            std::cout << "bestmove " << (line.empty() ? "0000" : line[0].AlgebraicNotation(board.IsFlipped())) << std::endl;
+        }
+
         void CommandGo(const std::vector<std::string> &words, const Board &board) {
             int depth = 8;
             int index;
@@ -83,9 +239,13 @@ namespace ChessEngine::UCI{
 
     void MainLoop(){
         Board board;
+        Settings settings;
+        MCTS::Searcher searcher;
         while(true) {
-            char command[BUFFER_SIZE];
-            std::cin.getline(command, BUFFER_SIZE);
+            // Long games make long position commands , the line is not bounded.
+            std::string command;
+            if(!std::getline(std::cin, command))
+                break;
 
             auto words = Tokenise(command);
             int index;
@@ -95,12 +255,21 @@ namespace ChessEngine::UCI{
                 std::cout << "readyok" << std::endl;
             }else if(FindWord(words, "ucinewgame", index)){
                 // Reset TT. TODO
+                searcher.Clear();
             }else if(FindWord(words, "position", index)){
                 board = CommandPosition(words);
             }else if(FindWord(words, "go", index)){
-                CommandGo(words, board);
+                if(FindWord(words, "mate", index)){
+                    CommandGoMate(words, board, index);
+                }else if(settings.search_mode == SearchMode::MCTS){
+                    CommandGoMCTS(words, board, searcher);
+                }else{
+                    CommandGo(words, board);
+                }
             }else if(FindWord(words, "stop", index)){
                 // Stop search timer. TODO
+            }else if(FindWord(words, "setoption", index)){
+                CommandSetOption(words, settings, searcher);
             }else if(FindWord(words, "quit", index)){
                 return;
             }
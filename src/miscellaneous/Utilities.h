@@ -1,9 +1,11 @@
 #ifndef ENGINE_UTIL_H
 #define ENGINE_UTIL_H
 
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -13,7 +15,6 @@
 
 #define ERROR 1
 #define IF_ERROR(cond, msg) {if(cond) { std::cout << "[ERROR] " << msg << std::endl; return ERROR;}}
-#define BUFFER_SIZE 1024 * 2
 #define CACHE_LINE_SIZE 64
 
 namespace ChessEngine {
@@ -44,49 +45,49 @@ namespace ChessEngine {
 
     namespace Masks{
         // Files.
-        const Bitboard file_A = Bitboard(0x0101010101010101ULL);
-        const Bitboard file_B = file_A.ShiftTowards({1,0});
-        const Bitboard file_G = file_A.ShiftTowards({6,0});
-        const Bitboard file_H = file_A.ShiftTowards({7,0});
+        constexpr Bitboard file_A = Bitboard(0x0101010101010101ULL);
+        constexpr Bitboard file_B = file_A.ShiftTowards({1,0});
+        constexpr Bitboard file_G = file_A.ShiftTowards({6,0});
+        constexpr Bitboard file_H = file_A.ShiftTowards({7,0});
 
         // Not files.
-        const Bitboard not_file_A = ~file_A;
-        const Bitboard not_file_B = ~file_B;
-        const Bitboard not_file_G = ~file_G;
-        const Bitboard not_file_H = ~file_H;
-        const Bitboard not_file_AB = ~(file_A | file_B);
-        const Bitboard not_file_GH = ~(file_H | file_G);
+        constexpr Bitboard not_file_A = ~file_A;
+        constexpr Bitboard not_file_B = ~file_B;
+        constexpr Bitboard not_file_G = ~file_G;
+        constexpr Bitboard not_file_H = ~file_H;
+        constexpr Bitboard not_file_AB = ~(file_A | file_B);
+        constexpr Bitboard not_file_GH = ~(file_H | file_G);
 
         // Ranks.
-        const Bitboard rank_1 = Bitboard(0xff);
-        const Bitboard rank_2 = rank_1.ShiftTowards({0,1});
-        const Bitboard rank_3 = rank_1.ShiftTowards({0,2});
-        const Bitboard rank_4 = rank_1.ShiftTowards({0,3});
-        const Bitboard rank_6 = rank_1.ShiftTowards({0,5});
-        const Bitboard rank_7 = rank_1.ShiftTowards({0,6});
-        const Bitboard rank_8 = rank_1.ShiftTowards({0,7});
-        const Bitboard rank_1_8 = rank_1 | rank_8;
-
-        const Bitboard outer_tiles = rank_1 | rank_8  | file_A | file_H;
-        const Bitboard inner_tiles = ~outer_tiles;
-        const Bitboard empty = Bitboard(0);
+        constexpr Bitboard rank_1 = Bitboard(0xff);
+        constexpr Bitboard rank_2 = rank_1.ShiftTowards({0,1});
+        constexpr Bitboard rank_3 = rank_1.ShiftTowards({0,2});
+        constexpr Bitboard rank_4 = rank_1.ShiftTowards({0,3});
+        constexpr Bitboard rank_6 = rank_1.ShiftTowards({0,5});
+        constexpr Bitboard rank_7 = rank_1.ShiftTowards({0,6});
+        constexpr Bitboard rank_8 = rank_1.ShiftTowards({0,7});
+        constexpr Bitboard rank_1_8 = rank_1 | rank_8;
+
+        constexpr Bitboard outer_tiles = rank_1 | rank_8  | file_A | file_H;
+        constexpr Bitboard inner_tiles = ~outer_tiles;
+        constexpr Bitboard empty = Bitboard(0);
 
         // Corners.
-        const BoardTile a1_tile = BoardTile(0,0);
-        const BoardTile a8_tile = BoardTile(0,7);
-        const BoardTile h1_tile = BoardTile(7,0);
-        const BoardTile h8_tile = BoardTile(7,7);
-        const Bitboard corner_tiles = a1_tile | a8_tile | h1_tile | h8_tile;
+        constexpr BoardTile a1_tile = BoardTile(0,0);
+        constexpr BoardTile a8_tile = BoardTile(0,7);
+        constexpr BoardTile h1_tile = BoardTile(7,0);
+        constexpr BoardTile h8_tile = BoardTile(7,7);
+        constexpr Bitboard corner_tiles = a1_tile | a8_tile | h1_tile | h8_tile;
 
         // Castling.
-        const BoardTile king_default = BoardTile(4, 0);
-        const BoardTile queen_rook = BoardTile(0,0);
-        const BoardTile king_rook = BoardTile(7,0);
-        const Bitboard queen_castling_tiles = BoardTile(1,0) | BoardTile(2,0) | BoardTile(3,0);
-        const Bitboard king_castling_tiles = BoardTile(6,0) | BoardTile(5,0);
-
-        const Bitboard light_squares(0x55AA55AA55AA55AAULL);
-        const Bitboard dark_squares(0xAA55AA55AA55AA55ULL);
+        constexpr BoardTile king_default = BoardTile(4, 0);
+        constexpr BoardTile queen_rook = BoardTile(0,0);
+        constexpr BoardTile king_rook = BoardTile(7,0);
+        constexpr Bitboard queen_castling_tiles = BoardTile(1,0) | BoardTile(2,0) | BoardTile(3,0);
+        constexpr Bitboard king_castling_tiles = BoardTile(6,0) | BoardTile(5,0);
+
+        constexpr Bitboard light_squares(0x55AA55AA55AA55AAULL);
+        constexpr Bitboard dark_squares(0xAA55AA55AA55AA55ULL);
     }
 
     bool CharToPieceInfo(char token, PieceInfo &piece_info);
@@ -116,6 +117,32 @@ namespace ChessEngine {
     #endif
     }
 
+    // Splits [0, count) into contiguous ranges processed by [threads] threads.
+    template<typename Function>
+    void ParallelFor(int count, int threads, Function process_range) {
+        threads = std::max(1, std::min(threads, count));
+        if(threads == 1) {
+            process_range(0, count);
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        int range_size = (count + threads - 1) / threads;
+        for (int begin = 0; begin < count; begin += range_size)
+            workers.emplace_back(process_range, begin, std::min(count, begin + range_size));
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    template<typename T>
+    void AlignedFree(T* mem) {
+    #if defined(_WIN32)
+        _aligned_free(mem);
+    #else
+        free(mem);
+    #endif
+    }
+
 }
 
 #endif
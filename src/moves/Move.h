@@ -12,17 +12,38 @@ namespace ChessEngine {
 
     class Move {
     public:
+        // Special moves, set at generation time so playing a move does not have to detect them.
+        enum Flag{
+            Normal, DoublePush, EnPassant, Castling
+        };
 
-        Move(uint8_t from, uint8_t to, PieceType promotion):
-        data_((from & Masks::From) | ((to << 6) & Masks::To) | ((promotion << 12) & Masks::Promotion))
+        Move(uint8_t from, uint8_t to, PieceType promotion, PieceType moved = None, PieceType captured = None, Flag flag = Normal):
+        data_((from & Masks::From) | ((to << 6) & Masks::To) | ((promotion << 12) & Masks::Promotion) |
+              ((moved << 16) & Masks::Moved) | ((captured << 19) & Masks::Captured) | ((flag << 22) & Masks::Flags))
         {}
-        Move(BoardTile from, BoardTile to, PieceType promotion) : Move(from.GetIndex(), to.GetIndex(), promotion) {}
+        Move(BoardTile from, BoardTile to, PieceType promotion, PieceType moved = None, PieceType captured = None, Flag flag = Normal) :
+                Move(from.GetIndex(), to.GetIndex(), promotion, moved, captured, flag) {}
+        // Only from, to and promotion are known. Board::FindLegalMove completes it.
         Move(std::string algebraic_notation, bool is_flipped);
+        explicit Move(uint16_t compressed) : data_(compressed) {}
         Move() = default;
 
         BoardTile GetFrom() const {return BoardTile(data_ & Masks::From); }
         BoardTile GetTo() const {return BoardTile((data_ & Masks::To) >> 6); }
         PieceType GetPromotion() const {return static_cast<PieceType>((data_ & Masks::Promotion) >> 12); }
+        PieceType GetMovedPiece() const {return static_cast<PieceType>((data_ & Masks::Moved) >> 16); }
+        PieceType GetCapturedPiece() const {return static_cast<PieceType>((data_ & Masks::Captured) >> 19); }
+        Flag GetFlag() const {return static_cast<Flag>((data_ & Masks::Flags) >> 22); }
+        bool IsCapture() const { return GetCapturedPiece() != None; }
+        // Same move with the files mirrored (a <-> h) , for positions hashed by their reflection.
+        Move Reflected() const {
+            Move move = *this;
+            move.data_ ^= 0b111 | (0b111 << 6);
+            return move;
+        }
+
+        // From, to and promotion. Enough to find the move between the legal moves of its position.
+        uint16_t Compress() const { return data_ & (Masks::From | Masks::To | Masks::Promotion); }
 
         friend std::ostream& operator<<(std::ostream& os, const Move& move){
             std::string from_notation;
@@ -43,18 +64,29 @@ namespace ChessEngine {
         enum Masks{
             From = 0b111111,
             To = 0b111111 << 6,
-            Promotion = 0b1111 << 12
+            Promotion = 0b1111 << 12,
+            Moved = 0b111 << 16,
+            Captured = 0b111 << 19,
+            Flags = 0b11 << 22
         };
 
         // 6 bits : from
         // 6 bits : to
         // 4 bits : promotion
+        // 3 bits : moved piece type
+        // 3 bits : captured piece type , pawn for en passant
+        // 2 bits : flag
         // Promotions are exactly 2^3 = 7.
-        uint16_t data_ = 0;
+        uint32_t data_ = 0;
     };
 
     using MoveList = std::vector<Move>;
 
+    // Move categories of the generator. Evasions are the moves of a position in check.
+    enum class GenType{
+        Captures, Quiets, Evasions, All
+    };
+
 }
 
 #endif
\ No newline at end of file
@@ -11,197 +11,186 @@ namespace ChessEngine::PseudoMoves {
 
     namespace {
 
-        auto HandlePromotionAttacks(uint8_t from_offset, Bitboard moves, MoveList& move_list){
+        // Type of the enemy piece on [to]. The enemy king can not be captured.
+        // The en passant flag shares the last rank with the pieces so only real pawns are checked.
+        PieceType CapturedType(const Board::Representation& rep, BoardTile to){
+            if(rep.Pawns().Get(to))
+                return Pawn;
+            bool is_rook_queen = rep.rook_queens.Get(to);
+            bool is_bishop_queen = rep.bishop_queens.Get(to);
+            if(is_rook_queen)
+                return is_bishop_queen ? Queen : Rook;
+            return is_bishop_queen ? Bishop : Knight;
+        }
+
+        void HandlePromotionAttacks(const Board::Representation& rep, int8_t from_offset, Bitboard moves, MoveList& move_list){
             for(auto to : moves){
                 BoardTile from = to + from_offset;
                 assert(from != to);
-                move_list.push_back(Move(from, to, PieceType::Rook));
-                move_list.push_back(Move(from, to, PieceType::Bishop));
-                move_list.push_back(Move(from, to, PieceType::Queen));
-                move_list.push_back(Move(from, to, PieceType::Knight));
+                PieceType captured = rep.enemy_pieces.Get(to) ? CapturedType(rep, to) : None;
+                move_list.push_back(Move(from, to, PieceType::Rook, Pawn, captured));
+                move_list.push_back(Move(from, to, PieceType::Bishop, Pawn, captured));
+                move_list.push_back(Move(from, to, PieceType::Queen, Pawn, captured));
+                move_list.push_back(Move(from, to, PieceType::Knight, Pawn, captured));
             }
         };
 
-        void HandleAttacks(uint8_t from_offset, Bitboard moves,  MoveList& move_list){
+        // Pawn moves of a single kind , [from] is [from_offset] tiles away from each target.
+        void HandlePawnAttacks(int8_t from_offset, Bitboard moves, PieceType captured, Move::Flag flag, MoveList& move_list){
             for(auto to : moves){
                 BoardTile from = BoardTile(to.GetIndex() + from_offset);
                 assert(from != to);
-                Move move = Move(from, to, PieceType::None);
-                move_list.push_back(move);
+                move_list.push_back(Move(from, to, PieceType::None, Pawn, captured, flag));
             }
         }
 
-        void HandleAttacks(BoardTile from, Bitboard moves, MoveList& move_list){
+        void HandlePawnCaptures(const Board::Representation& rep, int8_t from_offset, Bitboard moves, MoveList& move_list){
             for(auto to : moves){
-                Move move = Move(from, to, PieceType::None);
+                BoardTile from = BoardTile(to.GetIndex() + from_offset);
                 assert(from != to);
-                move_list.push_back(move);
+                move_list.push_back(Move(from, to, PieceType::None, Pawn, CapturedType(rep, to)));
             }
         }
 
-        // Used for basic movement of kings and knights. Does not work with pawns.
-        template<typename GetAttacks>
-        void GetLeaperMoves(Bitboard piece, Bitboard exclude, const Board::Representation& rep, MoveList& move_list, GetAttacks get) {
-            for(auto from : piece){
-                Bitboard attacks = get(from.GetIndex());
-                HandleAttacks(from, attacks - exclude, move_list);
+        void HandleAttacks(const Board::Representation& rep, BoardTile from, PieceType moved, Bitboard moves, MoveList& move_list){
+            for(auto to : moves){
+                PieceType captured = rep.enemy_pieces.Get(to) ? CapturedType(rep, to) : None;
+                assert(from != to);
+                move_list.push_back(Move(from, to, PieceType::None, moved, captured));
             }
         }
 
-        // Used for basic movement of slider pieces.
+        // Used for basic movement of every piece but pawns.
         template<typename GetAttacks>
-        void GetSliderMoves(Bitboard piece, Bitboard exclude, const Board::Representation& rep, MoveList& move_list, GetAttacks get) {
-            Bitboard all = rep.own_pieces | rep.enemy_pieces;
-            for(auto from : piece){
-                Bitboard attacks = get(from.GetIndex(), all);
-                HandleAttacks(from, attacks - exclude, move_list);
+        void GetPieceMoves(const Board::Representation& rep, Bitboard pieces, PieceType moved, Bitboard targets, MoveList& move_list, GetAttacks get) {
+            for(auto from : pieces){
+                Bitboard attacks = get(from.GetIndex());
+                HandleAttacks(rep, from, moved, attacks & targets, move_list);
             }
         }
-    }
-
-    void GetPawnQuietMoves(const Board::Representation& rep, MoveList& move_list) {
-        // Since we can find the [from] value from each [to] , we calculate all the final moves in parallel
-        // with shifts instead of using pre computed attack tables. This function avoids branches as much
-        // as possible hence the very exhaustive implementations of each case in separate loops.
 
-        constexpr int8_t one_back_offset = -8;
-
-        Bitboard enemy = rep.enemy_pieces;
-
-        Bitboard pawns = rep.Pawns() & rep.own_pieces;;
-        Bitboard all = rep.own_pieces | enemy;
-        Bitboard pawns_up = pawns.ShiftUp1() - all;
-        Bitboard promotions = pawns_up & Masks::rank_8;
-        Bitboard quiet = pawns_up - promotions;
-
-        // Quiet single push.
-        HandleAttacks(one_back_offset, quiet, move_list);
-        // Push promotions.
-        HandlePromotionAttacks(one_back_offset, promotions, move_list);
-        // Double push.
-        Bitboard double_push = (pawns_up & Masks::rank_3).ShiftUp1() - all;
-        HandleAttacks(2 * one_back_offset, double_push, move_list);
-    }
-
-    void GetPawnCaptures(const Board::Representation& rep, MoveList& move_list) {
-        // Since we can find the [from] value from each [to] , we calculate all the final moves in parallel
-        // with shifts instead of using pre computed attack tables. This function avoids branches as much
-        // as possible hence the very exhaustive implementations of each case in separate loops.
-
-        constexpr int8_t one_back_offset = -8;
-        constexpr int8_t one_right_offset = 1;
-        constexpr int8_t one_left_offset = -1;
-
-        // En passant is in ranks 1 and 8. Since each time the board is mirrored we only
-        // need to check rank 8. We can consider said spot an enemy piece. This does not
-        // affect forward pushes because in front of en passant tile there is an enemy piece.
-        Bitboard enemy = rep.enemy_pieces | rep.EnPassant().ShiftDown2();
-
-        Bitboard pawns = rep.Pawns() & rep.own_pieces;
-
-        Bitboard captures_left = pawns.ShiftUp1Left1() & enemy & Masks::not_file_H;
-        Bitboard captures_right = pawns.ShiftUp1Right1() & enemy & Masks::not_file_A;
-        Bitboard capture_promotion_left = captures_left & Masks::rank_8;
-        Bitboard capture_promotion_right = captures_right & Masks::rank_8;
-        Bitboard capture_simple_left = captures_left - capture_promotion_left;
-        Bitboard capture_simple_right = captures_right - capture_promotion_right;
-
-        // Capture simple left.
-        HandleAttacks(one_back_offset + one_right_offset, capture_simple_left, move_list);
-        // Capture simple right.
-        HandleAttacks(one_back_offset + one_left_offset, capture_simple_right, move_list);
-        // Capture promotion left.
-        HandlePromotionAttacks(one_back_offset + one_right_offset, capture_promotion_left, move_list);
-        // Capture promotion right.
-        HandlePromotionAttacks(one_back_offset + one_left_offset, capture_promotion_right, move_list);
-    }
-
-    void GetKnightQuietMoves(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard knights = rep.Knights() & rep.own_pieces;
-        GetLeaperMoves(knights, rep.own_pieces | rep.enemy_pieces, rep, move_list, AttackTables::KnightAttacks);
-    }
-
-    void GetKnightCaptures(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard knights = rep.Knights() & rep.own_pieces;
-        GetLeaperMoves(knights, ~rep.enemy_pieces, rep, move_list, AttackTables::KnightAttacks);
-    }
+        template <GenType type>
+        void GetPawnMoves(const Board::Representation& rep, Bitboard evasions, MoveList& move_list) {
+            // Since we can find the [from] value from each [to] , we calculate all the final moves in parallel
+            // with shifts instead of using pre computed attack tables. This function avoids branches as much
+            // as possible hence the very exhaustive implementations of each case in separate loops.
+
+            constexpr int8_t one_back_offset = -8;
+            constexpr int8_t one_right_offset = 1;
+            constexpr int8_t one_left_offset = -1;
+
+            Bitboard enemy = rep.enemy_pieces;
+            Bitboard pawns = rep.Pawns() & rep.own_pieces;
+            Bitboard all = rep.own_pieces | enemy;
+
+            if constexpr (type != GenType::Quiets) {
+                // En passant is in ranks 1 and 8. Since each time the board is mirrored we only
+                // need to check rank 8. We can consider said spot an enemy piece. This does not
+                // affect forward pushes because in front of en passant tile there is an enemy piece.
+                // It is kept when evading since the captured pawn is not on the en passant tile.
+                Bitboard capturable = enemy;
+                if constexpr (type == GenType::Evasions)
+                    capturable &= evasions;
+                Bitboard enPassant = rep.EnPassant().ShiftDown2();
+
+                Bitboard captures_left = pawns.ShiftUp1Left1() & capturable & Masks::not_file_H;
+                Bitboard captures_right = pawns.ShiftUp1Right1() & capturable & Masks::not_file_A;
+                Bitboard capture_promotion_left = captures_left & Masks::rank_8;
+                Bitboard capture_promotion_right = captures_right & Masks::rank_8;
+                Bitboard capture_simple_left = captures_left - capture_promotion_left;
+                Bitboard capture_simple_right = captures_right - capture_promotion_right;
+                Bitboard enPassant_left = pawns.ShiftUp1Left1() & enPassant & Masks::not_file_H;
+                Bitboard enPassant_right = pawns.ShiftUp1Right1() & enPassant & Masks::not_file_A;
+
+                // Capture simple left.
+                HandlePawnCaptures(rep, one_back_offset + one_right_offset, capture_simple_left, move_list);
+                HandlePawnAttacks(one_back_offset + one_right_offset, enPassant_left, Pawn, Move::EnPassant, move_list);
+                // Capture simple right.
+                HandlePawnCaptures(rep, one_back_offset + one_left_offset, capture_simple_right, move_list);
+                HandlePawnAttacks(one_back_offset + one_left_offset, enPassant_right, Pawn, Move::EnPassant, move_list);
+                // Capture promotion left.
+                HandlePromotionAttacks(rep, one_back_offset + one_right_offset, capture_promotion_left, move_list);
+                // Capture promotion right.
+                HandlePromotionAttacks(rep, one_back_offset + one_left_offset, capture_promotion_right, move_list);
+            }
 
-    void GetKingQuietMoves(const Board::Representation& rep, Board::CastlingRights rights, MoveList &move_list) {
-        BoardTile king = rep.own_king;
-        GetLeaperMoves(Bitboard(king), rep.own_pieces | rep.enemy_pieces, rep, move_list, AttackTables::KingAttacks);
-
-        // Castling. King should be at the default position.
-        // The castling flags will be checked later.
-        if(king != Masks::king_default)
-            return;
-
-        // Check if rooks exist at correct tiles and if in between tiles are empty.
-        Bitboard all = rep.own_pieces | rep.enemy_pieces;
-        BoardTile from = Masks::king_default;
-        if(rights.CanOwnQueenSide() && (all & Masks::queen_castling_tiles).IsEmpty()){
-            BoardTile to = Masks::queen_rook + 2; // 2 tiles right from rook.
-            assert(from != to);
-            move_list.push_back(Move(from, to, PieceType::None));
-        }
-        if(rights.CanOwnKingSide() && (all & Masks::king_castling_tiles).IsEmpty()){
-            BoardTile to = Masks::king_rook - 1; // Left of rook.
-            assert(from != to);
-            move_list.push_back(Move(from, to, PieceType::None));
+            if constexpr (type != GenType::Captures) {
+                Bitboard pawns_up = pawns.ShiftUp1() - all;
+                Bitboard double_push = (pawns_up & Masks::rank_3).ShiftUp1() - all;
+                if constexpr (type == GenType::Evasions) {
+                    pawns_up &= evasions;
+                    double_push &= evasions;
+                }
+                Bitboard promotions = pawns_up & Masks::rank_8;
+                Bitboard quiet = pawns_up - promotions;
+
+                // Quiet single push.
+                HandlePawnAttacks(one_back_offset, quiet, None, Move::Normal, move_list);
+                // Push promotions.
+                HandlePromotionAttacks(rep, one_back_offset, promotions, move_list);
+                // Double push.
+                HandlePawnAttacks(2 * one_back_offset, double_push, None, Move::DoublePush, move_list);
+            }
         }
-    }
 
-    void GetKingCaptures(const Board::Representation& rep, MoveList &move_list) {
-        BoardTile king = rep.own_king;
-        GetLeaperMoves(Bitboard(king), ~rep.enemy_pieces, rep, move_list, AttackTables::KingAttacks);
-    }
-
-    void GetQueenQuietMoves(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard queens = rep.Queens() & rep.own_pieces;
-        GetSliderMoves(queens, rep.own_pieces | rep.enemy_pieces, rep, move_list, AttackTables::QueenAttacks);
-    }
+        void GetCastlingMoves(const Board::Representation& rep, Board::CastlingRights rights, MoveList& move_list) {
+            // King should be at the default position. Attacked tiles are checked later.
+            if(rep.own_king != Masks::king_default)
+                return;
 
-    void GetQueenCaptures(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard queens = rep.Queens() & rep.own_pieces;
-        GetSliderMoves(queens, ~rep.enemy_pieces, rep, move_list, AttackTables::QueenAttacks);
-    }
-
-    void GetRookQuietMoves(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard rooks = rep.Rooks() & rep.own_pieces;
-        GetSliderMoves(rooks, rep.own_pieces | rep.enemy_pieces, rep, move_list, AttackTables::RookAttacks);
-    }
-
-    void GetRookCaptures(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard rooks = rep.Rooks() & rep.own_pieces;
-        GetSliderMoves(rooks, ~rep.enemy_pieces, rep, move_list, AttackTables::RookAttacks);
-    }
-
-    void GetBishopQuietMoves(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard bishops = rep.Bishops() & rep.own_pieces;
-        GetSliderMoves(bishops, rep.own_pieces | rep.enemy_pieces, rep, move_list, AttackTables::BishopAttacks);
-    }
-
-    void GetBishopCaptures(const Board::Representation& rep, MoveList& move_list) {
-        Bitboard bishops = rep.Bishops() & rep.own_pieces;
-        GetSliderMoves(bishops, ~rep.enemy_pieces, rep, move_list, AttackTables::BishopAttacks);
+            // Check if rooks exist at correct tiles and if in between tiles are empty.
+            Bitboard all = rep.own_pieces | rep.enemy_pieces;
+            BoardTile from = Masks::king_default;
+            if(rights.CanOwnQueenSide() && (all & Masks::queen_castling_tiles).IsEmpty()){
+                BoardTile to = Masks::queen_rook + 2; // 2 tiles right from rook.
+                move_list.push_back(Move(from, to, PieceType::None, King, None, Move::Castling));
+            }
+            if(rights.CanOwnKingSide() && (all & Masks::king_castling_tiles).IsEmpty()){
+                BoardTile to = Masks::king_rook - 1; // Left of rook.
+                move_list.push_back(Move(from, to, PieceType::None, King, None, Move::Castling));
+            }
+        }
     }
 
-    void GetQuietMoves(const Board::Representation& representation, Board::CastlingRights rights, MoveList& move_list){
-        GetPawnQuietMoves(representation, move_list);
-        GetKnightQuietMoves(representation, move_list);
-        GetBishopQuietMoves(representation, move_list);
-        GetRookQuietMoves(representation, move_list);
-        GetQueenQuietMoves(representation, move_list);
-        GetKingQuietMoves(representation, rights, move_list);
-    }
+    template <GenType type>
+    void Generate(const Board::Representation& rep, Board::CastlingRights rights, Bitboard evasions, MoveList& move_list) {
+        Bitboard own = rep.own_pieces;
+        Bitboard enemy = rep.enemy_pieces;
+        Bitboard all = own | enemy;
+
+        // Tiles the pieces can land on. The king can always leave the checking lines.
+        Bitboard targets, king_targets;
+        if constexpr (type == GenType::Captures) {
+            targets = king_targets = enemy;
+        } else if constexpr (type == GenType::Quiets) {
+            targets = king_targets = ~all;
+        } else if constexpr (type == GenType::Evasions) {
+            targets = evasions - own;
+            king_targets = ~own;
+        } else {
+            targets = king_targets = ~own;
+        }
 
-    void GetCaptures(const Board::Representation& representation, MoveList& move_list){
-        GetPawnCaptures(representation, move_list);
-        GetKnightCaptures(representation, move_list);
-        GetBishopCaptures(representation, move_list);
-        GetRookCaptures(representation, move_list);
-        GetQueenCaptures(representation, move_list);
-        GetKingCaptures(representation, move_list);
+        GetPawnMoves<type>(rep, evasions, move_list);
+
+        auto knight_attacks = [](uint8_t tile_index) { return AttackTables::KnightAttacks(tile_index); };
+        auto bishop_attacks = [=](uint8_t tile_index) { return AttackTables::BishopAttacks(tile_index, all); };
+        auto rook_attacks = [=](uint8_t tile_index) { return AttackTables::RookAttacks(tile_index, all); };
+        auto queen_attacks = [=](uint8_t tile_index) { return AttackTables::QueenAttacks(tile_index, all); };
+        auto king_attacks = [](uint8_t tile_index) { return AttackTables::KingAttacks(tile_index); };
+        GetPieceMoves(rep, rep.Knights() & own, Knight, targets, move_list, knight_attacks);
+        GetPieceMoves(rep, rep.Bishops() & own, Bishop, targets, move_list, bishop_attacks);
+        GetPieceMoves(rep, rep.Rooks() & own, Rook, targets, move_list, rook_attacks);
+        GetPieceMoves(rep, rep.Queens() & own, Queen, targets, move_list, queen_attacks);
+        GetPieceMoves(rep, Bitboard(rep.own_king), King, king_targets, move_list, king_attacks);
+
+        if constexpr (type == GenType::Quiets || type == GenType::All)
+            GetCastlingMoves(rep, rights, move_list);
     }
 
+    template void Generate<GenType::Captures>(const Board::Representation&, Board::CastlingRights, Bitboard, MoveList&);
+    template void Generate<GenType::Quiets>(const Board::Representation&, Board::CastlingRights, Bitboard, MoveList&);
+    template void Generate<GenType::Evasions>(const Board::Representation&, Board::CastlingRights, Bitboard, MoveList&);
+    template void Generate<GenType::All>(const Board::Representation&, Board::CastlingRights, Bitboard, MoveList&);
 
-}
\ No newline at end of file
+}
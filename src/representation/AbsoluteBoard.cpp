@@ -0,0 +1,393 @@
+#include "AbsoluteBoard.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include <representation/AttackTables.h>
+#include <search/NNUE.h>
+#include <search/ZobristKey.h>
+
+namespace ChessEngine {
+
+    namespace {
+        constexpr Team Opponent(Team team) { return team == White ? Black : White; }
+
+        // Positive offsets shift towards rank 8.
+        template <int offset>
+        constexpr Bitboard Shift(Bitboard board) {
+            if constexpr (offset > 0)
+                return Bitboard(board.AsInt() << offset);
+            else
+                return Bitboard(board.AsInt() >> -offset);
+        }
+
+        // Tiles attacked by a pawn of [team] standing on [tile_index].
+        template <Team team>
+        Bitboard PawnAttacks(uint8_t tile_index) {
+            if constexpr (team == White)
+                return AttackTables::PawnsAttacks(tile_index);
+            else {
+                Bitboard pawn = Bitboard(std::uint64_t(1) << tile_index);
+                return Shift<-9>(pawn - Masks::file_A) | Shift<-7>(pawn - Masks::file_H);
+            }
+        }
+
+        // Adds a move for every target , the origin is [offset] tiles behind it.
+        template <int offset>
+        void AddMoves(Bitboard targets, MoveList& moves) {
+            for (auto tile : targets)
+                moves.emplace_back(tile.GetIndex() - offset, tile.GetIndex(), None);
+        }
+
+        template <int offset>
+        void AddPromotions(Bitboard targets, MoveList& moves) {
+            for (auto tile : targets) {
+                uint8_t to = tile.GetIndex();
+                for (PieceType promotion : {Queen, Rook, Bishop, Knight})
+                    moves.emplace_back(to - offset, to, promotion);
+            }
+        }
+
+        void AddMoves(uint8_t from, Bitboard targets, MoveList& moves) {
+            for (auto tile : targets)
+                moves.emplace_back(from, tile.GetIndex(), None);
+        }
+    }
+
+    AbsoluteBoard::AbsoluteBoard(const Board& board) {
+        bool is_flipped = board.IsFlipped();
+        side_to_move_ = is_flipped ? Black : White;
+
+        // Board reports its pieces from the side to move , which is always white.
+        for (uint8_t square = 0; square < 64; square++) {
+            BoardTile relative_tile = BoardTile(square ^ (is_flipped ? 0b111000 : 0));
+            auto[type, team] = board.GetPieceInfoAt(relative_tile);
+            if (type == None)
+                continue;
+
+            Team absolute_team = (team == White) != is_flipped ? White : Black;
+            pieces_[absolute_team].Set(square);
+            types_[type].Set(square);
+            mailbox_[square] = type;
+            if (type == King)
+                kings_[absolute_team] = BoardTile(square);
+        }
+
+        // Kings take the first 2 indices of the piece list.
+        piece_list_.AddPiece(NNUE::GetPieceEncoding(King, White), kings_[White].GetIndex());
+        piece_list_.AddPiece(NNUE::GetPieceEncoding(King, Black), kings_[Black].GetIndex());
+        for (Team team : {White, Black}) {
+            for (auto tile : pieces_[team] - types_[King])
+                piece_list_.AddPiece(NNUE::GetPieceEncoding(mailbox_[tile.GetIndex()], team), tile.GetIndex());
+        }
+
+        castling_rights_ = board.GetCastlingRights();
+        if (is_flipped)
+            castling_rights_.Mirror();
+
+        // The en passant flag of Board is set on the last rank of the side to move.
+        Bitboard enPassant = board.GetRepresentation().EnPassant() & Masks::rank_8;
+        if (!enPassant.IsEmpty()) {
+            uint8_t file = enPassant.BitScanForward().GetFile();
+            en_passant_ = BoardTile(file, side_to_move_ == White ? R6 : R3).GetIndex();
+        }
+
+        // Both representations hash the same absolute position.
+        zobrist_key_ = board.GetZobristKey();
+    }
+
+    void AbsoluteBoard::AddPiece(Team team, PieceType type, uint8_t square) {
+        pieces_[team].Set(square);
+        types_[type].Set(square);
+        mailbox_[square] = type;
+        piece_list_.AddPiece(NNUE::GetPieceEncoding(type, team), square);
+        zobrist_key_ ^= Zobrist::GetPieceSquareKey(type, team == White, square);
+    }
+
+    void AbsoluteBoard::RemovePiece(Team team, PieceType type, uint8_t square) {
+        pieces_[team].Reset(square);
+        types_[type].Reset(square);
+        mailbox_[square] = None;
+        piece_list_.RemovePiece(square);
+        zobrist_key_ ^= Zobrist::GetPieceSquareKey(type, team == White, square);
+    }
+
+    void AbsoluteBoard::MovePiece(Team team, PieceType type, uint8_t from, uint8_t to) {
+        Bitboard from_to = Bitboard(std::uint64_t(1) << from | std::uint64_t(1) << to);
+        pieces_[team] = Bitboard(pieces_[team].AsInt() ^ from_to.AsInt());
+        types_[type] = Bitboard(types_[type].AsInt() ^ from_to.AsInt());
+        mailbox_[from] = None;
+        mailbox_[to] = type;
+        piece_list_.MovePiece(from, to);
+        zobrist_key_ ^= Zobrist::GetPieceSquareKey(type, team == White, from);
+        zobrist_key_ ^= Zobrist::GetPieceSquareKey(type, team == White, to);
+    }
+
+    void AbsoluteBoard::UpdateCastlingRights(uint8_t square) {
+        // Any move from or to a king or rook home square removes its rights.
+        switch (square) {
+            case 0: castling_rights_.ResetOwnQueenSide(); break;
+            case 7: castling_rights_.ResetOwnKingSide(); break;
+            case 4:
+                castling_rights_.ResetOwnQueenSide();
+                castling_rights_.ResetOwnKingSide();
+                break;
+            case 56: castling_rights_.ResetEnemyQueenSide(); break;
+            case 63: castling_rights_.ResetEnemyKingSide(); break;
+            case 60:
+                castling_rights_.ResetEnemyQueenSide();
+                castling_rights_.ResetEnemyKingSide();
+                break;
+            default:
+                break;
+        }
+    }
+
+    template <Team us>
+    bool AbsoluteBoard::IsUnderAttack(uint8_t tile_index) const {
+        constexpr Team them = Opponent(us);
+        Bitboard enemy = pieces_[them];
+        Bitboard all = pieces_[us] | enemy;
+        Bitboard rook_queens = types_[Rook] | types_[Queen];
+        Bitboard bishop_queens = types_[Bishop] | types_[Queen];
+
+        if (!(AttackTables::KingAttacks(tile_index) & Bitboard(kings_[them])).IsEmpty())
+            return true;
+        if (!(AttackTables::RookAttacks(tile_index, all) & enemy & rook_queens).IsEmpty())
+            return true;
+        if (!(AttackTables::BishopAttacks(tile_index, all) & enemy & bishop_queens).IsEmpty())
+            return true;
+        if (!(AttackTables::KnightAttacks(tile_index) & enemy & types_[Knight]).IsEmpty())
+            return true;
+        // Enemy pawns attack the tile from where our pawn would attack.
+        return !(PawnAttacks<us>(tile_index) & enemy & types_[Pawn]).IsEmpty();
+    }
+
+    template <Team us>
+    Bitboard AbsoluteBoard::GetPins() const {
+        constexpr Team them = Opponent(us);
+        Bitboard pins(0);
+
+        Bitboard own = pieces_[us];
+        Bitboard enemy = pieces_[them];
+        Bitboard all = own | enemy;
+
+        uint8_t king_index = kings_[us].GetIndex();
+        Bitboard rook_pins = AttackTables::RookAttacks(king_index, all) & own;
+        Bitboard rook_mask = AttackTables::RookAttacks(king_index) & enemy & (types_[Rook] | types_[Queen]);
+        Bitboard bishop_pins = AttackTables::BishopAttacks(king_index, all) & own;
+        Bitboard bishop_mask = AttackTables::BishopAttacks(king_index) & enemy & (types_[Bishop] | types_[Queen]);
+
+        for (auto piece : rook_pins)
+            pins.SetIf(piece, !(AttackTables::RookAttacks(piece.GetIndex(), all) & rook_mask).IsEmpty());
+        for (auto piece : bishop_pins)
+            pins.SetIf(piece, !(AttackTables::BishopAttacks(piece.GetIndex(), all) & bishop_mask).IsEmpty());
+
+        return pins;
+    }
+
+    template <Team us>
+    void AbsoluteBoard::GetPseudoMoves(MoveList& moves) const {
+        constexpr Team them = Opponent(us);
+        constexpr int up = us == White ? 8 : -8;
+        constexpr Bitboard double_push_rank = us == White ? Masks::rank_3 : Masks::rank_6;
+        constexpr Bitboard promotion_rank = us == White ? Masks::rank_8 : Masks::rank_1;
+
+        Bitboard own = pieces_[us];
+        Bitboard enemy = pieces_[them];
+        Bitboard all = own | enemy;
+        Bitboard empty = ~all;
+
+        // Pawns.
+        Bitboard pawns = types_[Pawn] & own;
+        Bitboard single_pushes = Shift<up>(pawns) & empty;
+        Bitboard double_pushes = Shift<up>(single_pushes & double_push_rank) & empty;
+        Bitboard left_captures = Shift<up - 1>(pawns - Masks::file_A) & enemy;
+        Bitboard right_captures = Shift<up + 1>(pawns - Masks::file_H) & enemy;
+
+        AddMoves<up>(single_pushes - promotion_rank, moves);
+        AddMoves<2 * up>(double_pushes, moves);
+        AddMoves<up - 1>(left_captures - promotion_rank, moves);
+        AddMoves<up + 1>(right_captures - promotion_rank, moves);
+        AddPromotions<up>(single_pushes & promotion_rank, moves);
+        AddPromotions<up - 1>(left_captures & promotion_rank, moves);
+        AddPromotions<up + 1>(right_captures & promotion_rank, moves);
+
+        if (en_passant_ != 0) {
+            for (auto pawn : PawnAttacks<them>(en_passant_) & pawns)
+                moves.emplace_back(pawn.GetIndex(), en_passant_, None);
+        }
+
+        // Pieces.
+        for (auto tile : types_[Knight] & own)
+            AddMoves(tile.GetIndex(), AttackTables::KnightAttacks(tile.GetIndex()) - own, moves);
+        for (auto tile : (types_[Bishop] | types_[Queen]) & own)
+            AddMoves(tile.GetIndex(), AttackTables::BishopAttacks(tile.GetIndex(), all) - own, moves);
+        for (auto tile : (types_[Rook] | types_[Queen]) & own)
+            AddMoves(tile.GetIndex(), AttackTables::RookAttacks(tile.GetIndex(), all) - own, moves);
+
+        // King and castling. Attacked tiles are checked by the legality test.
+        uint8_t king = kings_[us].GetIndex();
+        AddMoves(king, AttackTables::KingAttacks(king) - own, moves);
+
+        constexpr uint8_t king_home = us == White ? 4 : 60;
+        bool can_queen_side = us == White ? castling_rights_.CanOwnQueenSide() : castling_rights_.CanEnemyQueenSide();
+        bool can_king_side = us == White ? castling_rights_.CanOwnKingSide() : castling_rights_.CanEnemyKingSide();
+        Bitboard queen_side_path = Bitboard(std::uint64_t(0b1110) << (king_home - 4));
+        Bitboard king_side_path = Bitboard(std::uint64_t(0b1100000) << (king_home - 4));
+        if (can_queen_side && (all & queen_side_path).IsEmpty())
+            moves.emplace_back(king_home, king_home - 2, None);
+        if (can_king_side && (all & king_side_path).IsEmpty())
+            moves.emplace_back(king_home, king_home + 2, None);
+    }
+
+    template <Team us>
+    bool AbsoluteBoard::IsLegalMove(const Move& move, const Bitboard& pins, bool is_in_check) const {
+        // Same scheme as Board , only king moves, checks , en passant and pins need a closer look.
+        auto try_move = [=, this]() {
+            AbsoluteBoard temp = *this;
+            temp.PlayMove<us>(move);
+            return !temp.IsUnderAttack<us>(temp.kings_[us].GetIndex());
+        };
+
+        BoardTile from = move.GetFrom();
+        BoardTile to = move.GetTo();
+        uint8_t from_file = from.GetFile();
+        uint8_t to_file = to.GetFile();
+
+        bool is_king = from == kings_[us];
+        bool is_castling = is_king && (abs(from_file - to_file) == 2);
+        bool is_enPassant = en_passant_ != 0 && to.GetIndex() == en_passant_ && mailbox_[from.GetIndex()] == Pawn;
+
+        if (is_enPassant)
+            return try_move();
+
+        if (is_in_check) {
+            if (is_castling)
+                return false;
+            return try_move();
+        }
+
+        if (is_king) {
+            // Check in between tile.
+            if (is_castling && IsUnderAttack<us>((from + (to_file - from_file) / 2).GetIndex()))
+                return false;
+            return try_move();
+        }
+
+        if (pins.Get(from)) {
+            auto[king_file, king_rank] = kings_[us].GetCoords();
+            const int dx_from = from_file - king_file;
+            const int dy_from = from.GetRank() - king_rank;
+            const int dx_to = to_file - king_file;
+            const int dy_to = to.GetRank() - king_rank;
+
+            // Pinned pieces can only move along the ray of the king.
+            if (dx_from == 0 || dx_to == 0)
+                return dx_from == dx_to;
+            return dx_from * dy_to == dx_to * dy_from;
+        }
+
+        return true;
+    }
+
+    template <Team us>
+    MoveList AbsoluteBoard::GetLegalMoves() const {
+        MoveList moves;
+        moves.reserve(80);
+        GetPseudoMoves<us>(moves);
+
+        Bitboard pins = GetPins<us>();
+        bool is_in_check = IsUnderAttack<us>(kings_[us].GetIndex());
+        auto is_illegal = [&](const Move& move) { return !IsLegalMove<us>(move, pins, is_in_check); };
+        moves.erase(std::remove_if(moves.begin(), moves.end(), is_illegal), moves.end());
+
+        return moves;
+    }
+
+    template <Team us>
+    void AbsoluteBoard::PlayMove(Move move) {
+        constexpr Team them = Opponent(us);
+        constexpr int up = us == White ? 8 : -8;
+
+        uint8_t from = move.GetFrom().GetIndex();
+        uint8_t to = move.GetTo().GetIndex();
+        PieceType promotion = move.GetPromotion();
+        PieceType moved = mailbox_[from];
+        PieceType captured = mailbox_[to];
+        assert(moved != None && captured != King);
+
+        // Old castling rights and en passant are removed from the key and added back once updated.
+        zobrist_key_ ^= Zobrist::GetCastlingKey(castling_rights_, false);
+        if (en_passant_ != 0)
+            zobrist_key_ ^= Zobrist::GetEnPassantKey(en_passant_ % 8);
+
+        if (captured != None)
+            RemovePiece(them, captured, to);
+
+        uint8_t new_enPassant = 0;
+        if (moved == Pawn) {
+            if (en_passant_ != 0 && to == en_passant_)
+                RemovePiece(them, Pawn, to - up);
+            else if (abs(to - from) == 16)
+                new_enPassant = from + up;
+        }
+
+        if (promotion != None) {
+            RemovePiece(us, Pawn, from);
+            AddPiece(us, promotion, to);
+        } else {
+            MovePiece(us, moved, from, to);
+        }
+
+        if (moved == King) {
+            kings_[us] = BoardTile(to);
+            if (to == from + 2)
+                MovePiece(us, Rook, from + 3, from + 1);
+            else if (to + 2 == from)
+                MovePiece(us, Rook, from - 4, from - 1);
+        }
+
+        UpdateCastlingRights(from);
+        UpdateCastlingRights(to);
+        en_passant_ = new_enPassant;
+
+        zobrist_key_ ^= Zobrist::GetCastlingKey(castling_rights_, false);
+        if (en_passant_ != 0)
+            zobrist_key_ ^= Zobrist::GetEnPassantKey(en_passant_ % 8);
+        zobrist_key_ ^= Zobrist::GetSideKey();
+        side_to_move_ = them;
+    }
+
+    MoveList AbsoluteBoard::GetLegalMoves() const {
+        return side_to_move_ == White ? GetLegalMoves<White>() : GetLegalMoves<Black>();
+    }
+
+    void AbsoluteBoard::PlayMove(Move move) {
+        if (side_to_move_ == White)
+            PlayMove<White>(move);
+        else
+            PlayMove<Black>(move);
+    }
+
+    bool AbsoluteBoard::IsInCheck() const {
+        if (side_to_move_ == White)
+            return IsUnderAttack<White>(kings_[White].GetIndex());
+        return IsUnderAttack<Black>(kings_[Black].GetIndex());
+    }
+
+    int Perft(const AbsoluteBoard& board, int depth) {
+        if (depth == 0)
+            return 1;
+
+        int nodes = 0;
+        for (const Move& move : board.GetLegalMoves()) {
+            AbsoluteBoard temp = board;
+            temp.PlayMove(move);
+            nodes += Perft(temp, depth - 1);
+        }
+
+        return nodes;
+    }
+
+}
@@ -0,0 +1,58 @@
+#ifndef ABSOLUTEBOARD_H
+#define ABSOLUTEBOARD_H
+
+#include <representation/Board.h>
+
+namespace ChessEngine {
+
+    // Alternative to Board that keeps absolute colours and squares instead of mirroring the
+    // board after every move. Move generation is templated on the side to move so the
+    // pawn directions and home ranks are compile time constants.
+    // Moves use absolute squares, they are not interchangeable with the moves of Board.
+    // Only built with ABSOLUTE_BOARD and used by the perft benchmark.
+    class AbsoluteBoard {
+    public:
+        explicit AbsoluteBoard(const Board& board);
+
+        Team GetSideToMove() const { return side_to_move_; }
+        uint64_t GetZobristKey() const { return zobrist_key_; }
+        const Board::PieceList& GetPieceList() const { return piece_list_; }
+
+        MoveList GetLegalMoves() const;
+        void PlayMove(Move move); // Plays the move and changes turn.
+        bool IsInCheck() const;
+
+    private:
+        template <Team us> void GetPseudoMoves(MoveList& moves) const;
+        template <Team us> Bitboard GetPins() const;
+        template <Team us> bool IsUnderAttack(uint8_t tile_index) const;
+        template <Team us> bool IsLegalMove(const Move& move, const Bitboard& pins, bool is_in_check) const;
+        template <Team us> MoveList GetLegalMoves() const;
+        template <Team us> void PlayMove(Move move);
+
+        // Keep bitboards, mailbox, piece list and zobrist key in sync.
+        void AddPiece(Team team, PieceType type, uint8_t square);
+        void RemovePiece(Team team, PieceType type, uint8_t square);
+        void MovePiece(Team team, PieceType type, uint8_t from, uint8_t to);
+        void UpdateCastlingRights(uint8_t square);
+
+        Bitboard pieces_[2]; // Indexed by team.
+        Bitboard types_[7]; // Indexed by piece type. Queens are not part of the rooks / bishops.
+        PieceType mailbox_[64] = {};
+        BoardTile kings_[2];
+
+        // Own rights are white's.
+        Board::CastlingRights castling_rights_;
+        // Square a pawn can capture en passant on , 0 if there is none.
+        uint8_t en_passant_ = 0;
+        Team side_to_move_ = White;
+
+        uint64_t zobrist_key_ = 0;
+        Board::PieceList piece_list_;
+    };
+
+    int Perft(const AbsoluteBoard& board, int depth);
+
+}
+
+#endif
@@ -1,31 +1,41 @@
 #include "AttackTables.h"
 
+#include <array>
+#include <bit>
+
+#include <miscellaneous/Cpu.h>
 #include <miscellaneous/Utilities.h>
 #include <miscellaneous/MagicNumbers.h>
 
-// TODO: _pex_u64 (not supported by my computer).
+#ifdef CPU_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace ChessEngine::AttackTables{
 
-    // Performance isn't crucial for these functions
-    // since they are run once when producing the tables.
+    // Every table is generated at compile time and lives in the binary's read only data.
+    // The generators only run inside the compiler. Slider ones run for every permutation
+    // of every square, so they are kept cheap to keep build times down.
     // The board is mirrored so we only care about white.
 
     namespace {
-        Bitboard pawn_attacks[64];
-        Bitboard king_attacks[64];
-        Bitboard knight_attacks[64];
+        constexpr int rook_pext_permutations = Pext::rook_permutations;
+        constexpr int bishop_pext_permutations = Pext::bishop_permutations;
+
+        using PextSquare = Pext::Square;
 
-        // Does not include outer tiles.
-        Bitboard bishop_relevant_rays[64];
-        Bitboard rook_relevant_rays[64];
+        using SquareTable = std::array<Bitboard, 64>;
 
-        Bitboard sliding_pieces_attacks[MagicNumbers::permutations] = {};
+    #ifdef USE_BMI2
+        SliderBackend slider_backend = SliderBackend::Pext;
+    #else
+        SliderBackend slider_backend = SliderBackend::Magic;
+    #endif
 
         // When overflowing / under flowing in files A,H we may end up in the
         // opposite direction producing faulty moves. The inverted fileMasks
         // handle those 2 cases.
-        Bitboard GetPawnAttacks(Bitboard board) {
+        constexpr Bitboard GetPawnAttacks(Bitboard board) {
             Bitboard left_attack, right_attack;
             left_attack = board.ShiftTowards({-1, 1}) & Masks::not_file_H;
             right_attack = board.ShiftTowards({1, 1}) & Masks::not_file_A;
@@ -33,7 +43,7 @@ namespace ChessEngine::AttackTables{
         }
 
         // Generate the attack moves of all pawns at the given bitboard based on color
-        Bitboard GetKnightAttacks(Bitboard board) {
+        constexpr Bitboard GetKnightAttacks(Bitboard board) {
             Bitboard moves{};
 
             moves |= board.ShiftTowards({-1, +2}) & Masks::not_file_H; // Up left.
@@ -50,7 +60,7 @@ namespace ChessEngine::AttackTables{
         }
 
         // Generate the attack moves of all pawns at the given bitboard based on color
-        Bitboard GetKingAttacks(Bitboard board) {
+        constexpr Bitboard GetKingAttacks(Bitboard board) {
             Bitboard moves{};
 
             moves |= board.ShiftTowards({+0, +1}); // Up.
@@ -67,10 +77,17 @@ namespace ChessEngine::AttackTables{
             return moves;
         }
 
-        // Generate the ray from a starting position towards a direction. Stops when it hits an occupancy bit.
-        // Last tile is also included.
-        Bitboard GetRay(BoardTile from, std::tuple<int8_t, int8_t> direction, Bitboard occupancies) {
-            auto[x, y] = from.GetCoords();
+        // Directions 0-3 move towards higher tile indices, 4-7 towards lower ones.
+        constexpr std::tuple<int8_t, int8_t> directions[8] = {
+                {0, 1}, {1, 1}, {1, 0}, {-1, 1}, {0, -1}, {-1, -1}, {-1, 0}, {1, -1}
+        };
+        constexpr int rook_directions[4] = {0, 2, 4, 6};
+        constexpr int bishop_directions[4] = {1, 3, 5, 7};
+
+        // Generate the ray from a starting position towards a direction in an empty board.
+        constexpr Bitboard GetEmptyRay(BoardTile from, std::tuple<int8_t, int8_t> direction) {
+            int x = from.GetFile();
+            int y = from.GetRank();
             auto[x_off, y_off] = direction;
 
             x += x_off;
@@ -78,8 +95,6 @@ namespace ChessEngine::AttackTables{
             Bitboard ray{};
             while (x >= 0 && x < 8 && y >= 0 && y < 8) {
                 ray |= Bitboard(x, y);
-                if (occupancies.Get(x, y))
-                    break;
                 x += x_off;
                 y += y_off;
             }
@@ -87,81 +102,218 @@ namespace ChessEngine::AttackTables{
             return ray;
         }
 
-        Bitboard GetRookRays(BoardTile from, Bitboard occupancies = Masks::empty) {
-            return GetRay(from, {0, 1}, occupancies) | GetRay(from, {0, -1}, occupancies) |
-                   GetRay(from, {1, 0}, occupancies) | GetRay(from, {-1, 0}, occupancies);
+        constexpr auto empty_rays = []{
+            std::array<std::array<Bitboard, 64>, 8> rays{};
+            for (int direction = 0; direction < 8; direction++) {
+                for (uint8_t tile_index = 0; tile_index < 64; tile_index++)
+                    rays[direction][tile_index] = GetEmptyRay(BoardTile(tile_index), directions[direction]);
+            }
+            return rays;
+        }();
+
+        // Ray towards a direction that stops at the first occupancy bit, which is also included.
+        // Cut at the nearest blocker instead of walking tile by tile to keep compile time evaluation cheap.
+        constexpr Bitboard GetRay(BoardTile from, int direction, Bitboard occupancies) {
+            Bitboard ray = empty_rays[direction][from.GetIndex()];
+            uint64_t blockers = (ray & occupancies).AsInt();
+            if (blockers == 0)
+                return ray;
+
+            int nearest = direction < 4 ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+            return ray - empty_rays[direction][nearest];
         }
 
-        Bitboard GetBishopRays(BoardTile from, Bitboard occupancies = Masks::empty) {
-            return GetRay(from, {1, 1}, occupancies) | GetRay(from, {-1, 1}, occupancies) |
-                   GetRay(from, {-1, -1}, occupancies) | GetRay(from, {1, -1}, occupancies);
+        constexpr Bitboard GetRookRays(BoardTile from, Bitboard occupancies = Masks::empty) {
+            Bitboard rays{};
+            for (int direction : rook_directions)
+                rays |= GetRay(from, direction, occupancies);
+            return rays;
         }
 
-        template <typename Set>
-        void ProduceSubSets(Bitboard set, Set process) {
-            uint64_t occupants_permutation = 0;
-            do {
-                process(Bitboard(occupants_permutation));
-                occupants_permutation = (occupants_permutation - set.AsInt()) & set.AsInt();
-            } while (occupants_permutation != 0);
+        constexpr Bitboard GetBishopRays(BoardTile from, Bitboard occupancies = Masks::empty) {
+            Bitboard rays{};
+            for (int direction : bishop_directions)
+                rays |= GetRay(from, direction, occupancies);
+            return rays;
         }
 
-        Bitboard RookHaltingMask(BoardTile tile){
+        constexpr Bitboard RookHaltingMask(BoardTile tile){
             // If tile is an outer edge we have to include said side. If we simply used the outer tiles mask
             // we would get 0 moves which is not the wanted outcome. This is achieved by creating a an outer tile masks
             // without the active side. We also include the corners.
             Bitboard mask = Masks::outer_tiles;
-            if(Masks::file_A.Get(tile)){
+            if(!(Masks::file_A & tile).IsEmpty()){
                 mask -= Masks::file_A;
             }
-            if(Masks::file_H.Get(tile)){
+            if(!(Masks::file_H & tile).IsEmpty()){
                 mask -= Masks::file_H;
             }
-            if(Masks::rank_1.Get(tile)){
+            if(!(Masks::rank_1 & tile).IsEmpty()){
                 mask -= Masks::rank_1;
             }
-            if(Masks::rank_8.Get(tile)){
+            if(!(Masks::rank_8 & tile).IsEmpty()){
                 mask -= Masks::rank_8;
             }
             return mask | Masks::corner_tiles;
         }
 
-    }
+        template <typename Generator>
+        constexpr SquareTable PerSquare(Generator generate){
+            SquareTable table{};
+            for (uint8_t tile_index = 0; tile_index < 64; tile_index++)
+                table[tile_index] = generate(BoardTile(tile_index));
+            return table;
+        }
 
-    void InitMoveTables(){
-        for (uint8_t rank = 0; rank < 8; rank++) {
-            for (uint8_t file = 0; file < 8; file++) {
-                BoardTile tile = BoardTile(file, rank);
-                Bitboard tile_board = Bitboard(tile);
-                uint8_t tile_index = tile.GetIndex();
-
-                // Leaper pieces.
-                pawn_attacks[tile_index] = GetPawnAttacks(tile_board);
-                king_attacks[tile_index] = GetKingAttacks(tile_board);
-                knight_attacks[tile_index] = GetKnightAttacks(tile_board);
-
-                // Relevant slider pieces rays. Meaning the ray in an empty board ,excluding outer edges.
-                bishop_relevant_rays[tile_index] = GetBishopRays(tile) - Masks::outer_tiles;
-                Bitboard halting_mask = RookHaltingMask(tile); // For cases where the rook is on an edge.
-                rook_relevant_rays[tile_index] = GetRookRays(tile) - halting_mask;
-
-                auto set_rooks = [=](Bitboard permutation){
-                    auto key = MagicNumbers::RookMagicHash(permutation, tile_index);
-                    auto value = GetRookRays(tile, permutation);
-                    assert(sliding_pieces_attacks[key].AsInt() == 0 || sliding_pieces_attacks[key] == value);
-                    sliding_pieces_attacks[key] = value;
-                };
-                auto set_bishops = [=](Bitboard permutation){
-                    auto key = MagicNumbers::BishopMagicHash(permutation, tile_index);
-                    auto value = GetBishopRays(tile, permutation);
-                    assert(sliding_pieces_attacks[key].AsInt() == 0 || sliding_pieces_attacks[key] == value);
-                    sliding_pieces_attacks[key] = value;
-                };
-                // Populates slider pieces attack table based on magic numbers for every permutation.
-                ProduceSubSets(rook_relevant_rays[tile_index], set_rooks);
-                ProduceSubSets(bishop_relevant_rays[tile_index], set_bishops);
+        // Leaper pieces.
+        constexpr SquareTable pawn_attacks = PerSquare([](BoardTile tile){ return GetPawnAttacks(Bitboard(tile)); });
+        constexpr SquareTable king_attacks = PerSquare([](BoardTile tile){ return GetKingAttacks(Bitboard(tile)); });
+        constexpr SquareTable knight_attacks = PerSquare([](BoardTile tile){ return GetKnightAttacks(Bitboard(tile)); });
+
+        // Relevant slider pieces rays. Meaning the ray in an empty board ,excluding outer edges.
+        constexpr SquareTable bishop_relevant_rays = PerSquare([](BoardTile tile){
+            return GetBishopRays(tile) - Masks::outer_tiles;
+        });
+        constexpr SquareTable rook_relevant_rays = PerSquare([](BoardTile tile){
+            return GetRookRays(tile) - RookHaltingMask(tile); // For cases where the rook is on an edge.
+        });
+
+        // Written on raw integers since the compiler evaluates it for every permutation of every square.
+        // Subsets are produced (carry rippler) in increasing pext order, so the table is filled in order.
+        template <int permutations>
+        constexpr std::array<Bitboard, permutations> PextAttackTable(const SquareTable& relevant_rays,
+                                                                     const int (&slider_directions)[4]){
+            std::array<Bitboard, permutations> table{};
+            uint32_t offset = 0;
+            for (uint8_t tile_index = 0; tile_index < 64; tile_index++) {
+                uint64_t mask = relevant_rays[tile_index].AsInt();
+                uint64_t rays[4] = {};
+                for (int i = 0; i < 4; i++)
+                    rays[i] = empty_rays[slider_directions[i]][tile_index].AsInt();
+
+                // Same as GetRay for the 4 directions.
+                uint64_t permutation = 0;
+                do {
+                    uint64_t attacks = 0;
+                    for (int i = 0; i < 4; i++) {
+                        uint64_t blockers = rays[i] & permutation;
+                        uint64_t ray = rays[i];
+                        if (blockers != 0) {
+                            int direction = slider_directions[i];
+                            int nearest = direction < 4 ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+                            ray &= ~empty_rays[direction][nearest].AsInt();
+                        }
+                        attacks |= ray;
+                    }
+                    table[offset++] = Bitboard(attacks);
+                    permutation = (permutation - mask) & mask;
+                } while (permutation != 0);
+            }
+            assert(offset == permutations);
+            return table;
+        }
+
+        constexpr std::array<PextSquare, 64> PextSquares(const SquareTable& relevant_rays){
+            std::array<PextSquare, 64> squares{};
+            uint32_t offset = 0;
+            for (uint8_t tile_index = 0; tile_index < 64; tile_index++) {
+                squares[tile_index] = {relevant_rays[tile_index], offset};
+                offset += 1u << std::popcount(relevant_rays[tile_index].AsInt());
+            }
+            return squares;
+        }
+
+        constexpr auto rook_pext_attacks = PextAttackTable<rook_pext_permutations>(rook_relevant_rays, rook_directions);
+        constexpr auto bishop_pext_attacks = PextAttackTable<bishop_pext_permutations>(bishop_relevant_rays, bishop_directions);
+        constexpr auto rook_pext_squares = PextSquares(rook_relevant_rays);
+        constexpr auto bishop_pext_squares = PextSquares(bishop_relevant_rays);
+
+    #ifndef USE_BMI2
+        // Populates slider pieces attack table based on magic numbers for every permutation.
+        // Values are copied from the pext tables, which hold the same rays in subset order.
+        template <size_t permutations>
+        constexpr void FillMagicTable(std::array<Bitboard, MagicNumbers::permutations>& table,
+                                      const std::array<Bitboard, permutations>& pext_attacks,
+                                      const std::array<PextSquare, 64>& pext_squares,
+                                      const MagicNumbers::SquareInfo (&magics)[64], uint64_t bit_offset){
+            for (uint8_t tile_index = 0; tile_index < 64; tile_index++) {
+                uint64_t mask = pext_squares[tile_index].mask.AsInt();
+                uint32_t index = pext_squares[tile_index].offset;
+                uint64_t magic_number = magics[tile_index].magic_number;
+                uint64_t main_table_offset = magics[tile_index].main_table_offset;
+                uint64_t permutation = 0;
+                do {
+                    // Same as the MagicHash functions.
+                    uint64_t key = ((permutation * magic_number) >> (64 - bit_offset)) + main_table_offset;
+                    assert(table[key].AsInt() == 0 || table[key] == pext_attacks[index]);
+                    table[key] = pext_attacks[index++];
+                    permutation = (permutation - mask) & mask;
+                } while (permutation != 0);
+            }
+        }
+
+        constexpr auto sliding_pieces_attacks = []{
+            std::array<Bitboard, MagicNumbers::permutations> table{};
+            FillMagicTable(table, rook_pext_attacks, rook_pext_squares, MagicNumbers::rookMagics, MagicNumbers::rook_bit_offset);
+            FillMagicTable(table, bishop_pext_attacks, bishop_pext_squares, MagicNumbers::bishopMagics, MagicNumbers::bishopBitOffset);
+            return table;
+        }();
+
+    #ifdef CPU_DISPATCH
+        TARGET_ISA("bmi2") Bitboard PextAttacks(const Bitboard* attacks, const PextSquare& square, Bitboard occupancies){
+            return attacks[square.offset + _pext_u64(occupancies.AsInt(), square.mask.AsInt())];
+        }
+    #else
+        // Portable pext, for builds without bmi2 intrinsics. Never picked at runtime.
+        uint64_t ParallelExtract(uint64_t value, uint64_t mask){
+            uint64_t result = 0;
+            for (uint64_t bit = 1; mask != 0; bit <<= 1) {
+                uint64_t lowest = mask & -mask;
+                if (value & lowest)
+                    result |= bit;
+                mask &= mask - 1;
             }
+            return result;
+        }
+
+        Bitboard PextAttacks(const Bitboard* attacks, const PextSquare& square, Bitboard occupancies){
+            return attacks[square.offset + ParallelExtract(occupancies.AsInt(), square.mask.AsInt())];
         }
+    #endif
+    #endif
+
+    }
+
+#ifdef USE_BMI2
+    namespace Pext{
+        constexpr std::array<Bitboard, rook_permutations> rook_attacks = rook_pext_attacks;
+        constexpr std::array<Bitboard, bishop_permutations> bishop_attacks = bishop_pext_attacks;
+        constexpr std::array<Square, 64> rook_squares = rook_pext_squares;
+        constexpr std::array<Square, 64> bishop_squares = bishop_pext_squares;
+    }
+#endif
+
+    void InitMoveTables(){
+        SetSliderBackend(Cpu::HasFastPEXT() ? SliderBackend::Pext : SliderBackend::Magic);
+    }
+
+    bool SetSliderBackend(SliderBackend backend){
+    #ifdef USE_BMI2
+        if (backend == SliderBackend::Magic)
+            return false;
+    #elif defined(CPU_DISPATCH)
+        if (backend == SliderBackend::Pext && !Cpu::HasBMI2())
+            return false;
+    #else
+        if (backend == SliderBackend::Pext)
+            return false;
+    #endif
+        slider_backend = backend;
+        return true;
+    }
+
+    SliderBackend GetSliderBackend(){
+        return slider_backend;
     }
 
     Bitboard PawnsAttacks(uint8_t tile_index){
@@ -176,13 +328,20 @@ namespace ChessEngine::AttackTables{
         return king_attacks[tile_index];
     }
 
+#ifndef USE_BMI2
     Bitboard RookAttacks(uint8_t tile_index, Bitboard occupancies){
+        if (slider_backend == SliderBackend::Pext)
+            return PextAttacks(rook_pext_attacks.data(), rook_pext_squares[tile_index], occupancies);
+
         Bitboard rays = rook_relevant_rays[tile_index];
         auto key = MagicNumbers::RookMagicHash(rays & occupancies, tile_index);
         return sliding_pieces_attacks[key];
     }
 
     Bitboard BishopAttacks(uint8_t tile_index, Bitboard occupancies){
+        if (slider_backend == SliderBackend::Pext)
+            return PextAttacks(bishop_pext_attacks.data(), bishop_pext_squares[tile_index], occupancies);
+
         Bitboard rays = bishop_relevant_rays[tile_index];
         auto key = MagicNumbers::BishopMagicHash(rays & occupancies, tile_index);
         return sliding_pieces_attacks[key];
@@ -192,4 +351,6 @@ namespace ChessEngine::AttackTables{
         return RookAttacks(tile_index, occupancies) | BishopAttacks(tile_index, occupancies);
     }
 
+#endif
+
 }
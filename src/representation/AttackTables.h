@@ -1,17 +1,70 @@
 #ifndef ATTACKTABLES_H
 #define ATTACKTABLES_H
 
+#include <array>
+
 #include <representation/Bitboard.h>
 
+#ifdef USE_BMI2
+#include <immintrin.h>
+#endif
+
 namespace ChessEngine::AttackTables{
+    // Slider lookups are indexed either by magic multiplication or by the bmi2 pext instruction.
+    enum class SliderBackend{
+        Magic, Pext
+    };
+
+    // The tables are generated at compile time and work without it. This only
+    // picks the pext backend when the cpu runs it fast. Call after Cpu::DetectFeatures.
     void InitMoveTables();
 
+    // Returns false if the backend is not supported by the cpu or the build.
+    bool SetSliderBackend(SliderBackend backend);
+    SliderBackend GetSliderBackend();
+
+    // Pext tables are dense. Every square owns 2^(relevant bits) consecutive entries from its offset.
+    namespace Pext{
+        constexpr int rook_permutations = 102400;
+        constexpr int bishop_permutations = 5248;
+
+        struct Square{
+            Bitboard mask;
+            uint32_t offset;
+        };
+    }
+
     Bitboard PawnsAttacks(uint8_t tile_index);
     Bitboard KnightAttacks(uint8_t tile_index);
     Bitboard KingAttacks(uint8_t tile_index);
+
+#ifdef USE_BMI2
+    // Builds for bmi2 cpus only look sliders up with pext inline , the magic backend is left out.
+    namespace Pext{
+        extern const std::array<Bitboard, rook_permutations> rook_attacks;
+        extern const std::array<Bitboard, bishop_permutations> bishop_attacks;
+        extern const std::array<Square, 64> rook_squares;
+        extern const std::array<Square, 64> bishop_squares;
+    }
+
+    inline Bitboard RookAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard()){
+        const Pext::Square& square = Pext::rook_squares[tile_index];
+        return Pext::rook_attacks[square.offset + _pext_u64(occupancies.AsInt(), square.mask.AsInt())];
+    }
+
+    inline Bitboard BishopAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard()){
+        const Pext::Square& square = Pext::bishop_squares[tile_index];
+        return Pext::bishop_attacks[square.offset + _pext_u64(occupancies.AsInt(), square.mask.AsInt())];
+    }
+
+    inline Bitboard QueenAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard()){
+        return RookAttacks(tile_index, occupancies) | BishopAttacks(tile_index, occupancies);
+    }
+#else
     Bitboard RookAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard());
     Bitboard BishopAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard());
     Bitboard QueenAttacks(uint8_t tile_index, Bitboard occupancies = Bitboard());
+#endif
 
 }
 
@@ -3,78 +3,138 @@
 
 #include <cstdint>
 #include <tuple>
+#include <version>
+
+#ifdef __cpp_lib_bitops
+#include <bit>
+#endif
 
 namespace ChessEngine {
 
     class BoardTile;
 
+    // Bit primitives under every hot loop. std::popcount / std::countr_zero compile to popcnt / tzcnt (bsf)
+    // when available. The portable versions are the fallback and the reference of the bitboard benchmark.
+    namespace BitOps {
+        constexpr uint8_t PortablePopCount(uint64_t value) {
+            uint8_t count = 0;
+            while(value){
+                count++;
+                value &= (value - 1);
+            }
+            return count;
+        }
+
+        /* De Bruijn bitscan algorithm */
+        constexpr uint64_t debruijn64 = 0x03f79d71b4cb0a89;
+        constexpr uint8_t debruijn_index64[64] = {
+                0, 1, 48, 2, 57, 49, 28, 3,
+                61, 58, 50, 42, 38, 29, 17, 4,
+                62, 55, 59, 36, 53, 51, 43, 22,
+                45, 39, 33, 30, 24, 18, 12, 5,
+                63, 47, 56, 27, 60, 41, 37, 16,
+                54, 35, 52, 21, 44, 32, 23, 11,
+                46, 26, 40, 15, 34, 20, 31, 10,
+                25, 14, 19, 9, 13, 8, 7, 6
+        };
+
+        constexpr uint8_t PortableLowestBit(uint64_t value) {
+            return debruijn_index64[((value & ~(value - 1)) * debruijn64) >> 58];
+        }
+
+        constexpr uint8_t PopCount(uint64_t value) {
+        #ifdef __cpp_lib_bitops
+            return std::popcount(value);
+        #else
+            return PortablePopCount(value);
+        #endif
+        }
+
+        // Undefined for 0.
+        constexpr uint8_t LowestBit(uint64_t value) {
+        #ifdef __cpp_lib_bitops
+            return std::countr_zero(value);
+        #else
+            return PortableLowestBit(value);
+        #endif
+        }
+    }
+
     class Bitboard {
     public:
         class Iterator{
         public:
-            explicit Iterator(uint64_t data): data_(data) {}
-            Iterator& operator++() { data_ &= (data_ - 1); return *this; } // Remove lsb.
-            Iterator operator++(int) { Iterator temp = *this; data_ &= (data_ - 1); return temp; } // Remove lsb.
-            BoardTile operator*() const; // Gets LSB tile.
+            constexpr explicit Iterator(uint64_t data): data_(data) {}
+            constexpr Iterator& operator++() { data_ &= (data_ - 1); return *this; } // Remove lsb.
+            constexpr Iterator operator++(int) { Iterator temp = *this; data_ &= (data_ - 1); return temp; } // Remove lsb.
+            constexpr BoardTile operator*() const; // Gets LSB tile. Defined in BoardTile.h.
 
-            friend bool operator!= (const Iterator& a, const Iterator& b) { return a.data_ != b.data_; };
-            friend bool operator== (const Iterator& a, const Iterator& b) { return a.data_ == b.data_; };
+            friend constexpr bool operator!= (const Iterator& a, const Iterator& b) { return a.data_ != b.data_; };
+            friend constexpr bool operator== (const Iterator& a, const Iterator& b) { return a.data_ == b.data_; };
         private:
 
             uint64_t data_;
         };
 
-        explicit Bitboard(uint64_t value) : data_(value) {}
-        explicit Bitboard(uint8_t file, uint8_t rank);
-        explicit Bitboard(BoardTile tile);
-        Bitboard() = default;
+        constexpr explicit Bitboard(uint64_t value) : data_(value) {}
+        constexpr explicit Bitboard(uint8_t file, uint8_t rank) : data_(std::uint64_t(1) << (rank * 8 + file)) {}
+        constexpr explicit Bitboard(BoardTile tile); // Defined in BoardTile.h.
+        constexpr Bitboard() = default;
 
-        bool Get(uint8_t index) const;
-        bool Get(uint8_t file, uint8_t rank) const;
-        bool Get(BoardTile tile) const;
+        // Tile overloads are defined in BoardTile.h.
+        constexpr bool Get(uint8_t index) const { return data_ & (std::uint64_t(1) << index); }
+        constexpr bool Get(uint8_t file, uint8_t rank) const { return Get(rank * 8 + file); }
+        constexpr bool Get(BoardTile tile) const;
 
-        void Set(uint8_t index);
-        void Set(uint8_t file, uint8_t rank);
-        void Set(BoardTile tile);
-        void SetIf(BoardTile tile, bool cond);
+        constexpr void Set(uint8_t index) { data_ |= std::uint64_t(1) << index; }
+        constexpr void Set(uint8_t file, uint8_t rank) { Set(rank * 8 + file); }
+        constexpr void Set(BoardTile tile);
+        constexpr void SetIf(BoardTile tile, bool cond);
 
-        void Reset(uint8_t index);
-        void Reset(uint8_t file, uint8_t rank);
-        void Reset(BoardTile tile);
+        constexpr void Reset(uint8_t index) { data_ &= ~(std::uint64_t(1) << index); }
+        constexpr void Reset(uint8_t file, uint8_t rank) { Reset(rank * 8 + file); }
+        constexpr void Reset(BoardTile tile);
 
-        uint64_t AsInt() const { return data_; }
-        uint8_t Count() const;
-        BoardTile BitScanForward();
+        constexpr uint64_t AsInt() const { return data_; }
+        constexpr uint8_t Count() const { return BitOps::PopCount(data_); }
+        constexpr BoardTile BitScanForward() const;
 
         // Slower but used for array init.
-        Bitboard ShiftTowards(std::tuple<int8_t, int8_t> direction) const;
+        constexpr Bitboard ShiftTowards(std::tuple<int8_t, int8_t> direction) const {
+            // index_curr = y * 8 + x
+            // index_new = (y+y_off)*8 + (x+x_off)
+            // index_new - index_curr =  8*y_off + x_off.
+            auto[x_offset, y_offset] = direction;
+            int offset = 8 * y_offset + x_offset;
+            return Bitboard(offset > 0 ? data_ << offset : data_ >> -offset);
+        }
         // Used inside pawn move gen.
-        Bitboard ShiftDown2() const { return Bitboard(data_ >> (2 * 8)); }
-        Bitboard ShiftUp1() const { return Bitboard(data_ << (1 * 8)); }
-        Bitboard ShiftUp1Right1() const { return Bitboard(data_ << (1 * 8 + 1)); }
-        Bitboard ShiftUp1Left1() const { return Bitboard(data_ << (1 * 8 - 1)); }
+        constexpr Bitboard ShiftDown2() const { return Bitboard(data_ >> (2 * 8)); }
+        constexpr Bitboard ShiftUp1() const { return Bitboard(data_ << (1 * 8)); }
+        constexpr Bitboard ShiftUp1Right1() const { return Bitboard(data_ << (1 * 8 + 1)); }
+        constexpr Bitboard ShiftUp1Left1() const { return Bitboard(data_ << (1 * 8 - 1)); }
 
         // Mirrors the board vertically.
         void Mirror();
         void Draw() const;
-        bool IsEmpty() const { return data_ == 0; }
+        constexpr bool IsEmpty() const { return data_ == 0; }
 
-        Iterator begin() const { return Iterator(data_); }
-        static Iterator end() { return Iterator(0); }
+        constexpr Iterator begin() const { return Iterator(data_); }
+        static constexpr Iterator end() { return Iterator(0); }
 
-        friend Bitboard operator|(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ | b.data_); }
-        friend Bitboard operator&(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ & b.data_); }
-        friend Bitboard operator>>(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ >> b.data_); }
-        friend Bitboard operator<<(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ << b.data_); }
-        friend Bitboard operator-(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ & ~b.data_); }
-        friend Bitboard operator~(const Bitboard& a) { return Bitboard(~a.data_); }
+        friend constexpr Bitboard operator|(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ | b.data_); }
+        friend constexpr Bitboard operator&(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ & b.data_); }
+        friend constexpr Bitboard operator>>(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ >> b.data_); }
+        friend constexpr Bitboard operator<<(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ << b.data_); }
+        friend constexpr Bitboard operator-(const Bitboard& a, const Bitboard& b) { return Bitboard(a.data_ & ~b.data_); }
+        friend constexpr Bitboard operator~(const Bitboard& a) { return Bitboard(~a.data_); }
 
-        Bitboard& operator&=(const Bitboard& a) { data_ &= a.data_; return *this; }
-        Bitboard& operator|=(const Bitboard& a) { data_ |= a.data_; return *this; }
-        Bitboard& operator-=(const Bitboard& a) { data_ &= ~a.data_; return *this; }
+        constexpr Bitboard& operator&=(const Bitboard& a) { data_ &= a.data_; return *this; }
+        constexpr Bitboard& operator|=(const Bitboard& a) { data_ |= a.data_; return *this; }
+        constexpr Bitboard& operator-=(const Bitboard& a) { data_ &= ~a.data_; return *this; }
 
-        bool operator==(const Bitboard& other) const { return data_ == other.data_; }
-        bool operator!=(const Bitboard& other) const { return data_ != other.data_; }
+        constexpr bool operator==(const Bitboard& other) const { return data_ == other.data_; }
+        constexpr bool operator!=(const Bitboard& other) const { return data_ != other.data_; }
 
     private:
         uint64_t data_ = 0;
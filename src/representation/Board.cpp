@@ -11,6 +11,34 @@
 
 namespace ChessEngine {
 
+    namespace {
+        // Piece list codes (see NNUE::GetPieceEncoding) to piece types.
+        constexpr PieceType piece_code_types[13] = {
+                None, King, Queen, Rook, Bishop, Knight, Pawn, King, Queen, Rook, Bishop, Knight, Pawn
+        };
+        constexpr uint8_t first_black_piece_code = 7;
+
+        // True if [to] lies on the line from [origin] through [from].
+        // The vector {from-origin} has to be codirectional with the vector {to-origin}.
+        // This is checked by comparing the slopes dy_from / dx_from = dy_to / dx_to.
+        inline bool IsAligned(BoardTile origin, BoardTile from, BoardTile to) {
+            auto[origin_file, origin_rank] = origin.GetCoords();
+            const int dx_from = from.GetFile() - origin_file;
+            const int dy_from = from.GetRank() - origin_rank;
+            const int dx_to = to.GetFile() - origin_file;
+            const int dy_to = to.GetRank() - origin_rank;
+
+            if (dx_from == 0 || dx_to == 0)
+                return dx_from == dx_to;
+            return dx_from * dy_to == dx_to * dy_from;
+        }
+
+        // Tile of the (possibly mirrored) board to the absolute square of the piece list.
+        inline uint8_t AbsoluteSquare(uint8_t file, uint8_t rank, bool is_flipped) {
+            return BoardTile(file, rank).GetIndex() ^ (is_flipped ? 0b111000 : 0);
+        }
+    }
+
     void Board::Representation::Mirror() {
         rook_queens.Mirror();
         bishop_queens.Mirror();
@@ -25,6 +53,37 @@ namespace ChessEngine {
         std::swap(own_king, enemy_king);
     }
 
+    void Board::PieceList::AddPiece(int piece, uint8_t square) {
+        assert(size < max_pieces);
+        pieces[size] = piece;
+        squares[size] = square;
+        index[square] = size;
+        piece_at[square] = piece;
+        size++;
+        pieces[size] = 0;
+    }
+
+    void Board::PieceList::RemovePiece(uint8_t square) {
+        // The last piece takes the place of the removed one.
+        // Kings are never removed so they keep their first 2 indices.
+        uint8_t removed_index = index[square];
+        assert(removed_index > 1);
+        size--;
+        pieces[removed_index] = pieces[size];
+        squares[removed_index] = squares[size];
+        index[squares[removed_index]] = removed_index;
+        pieces[size] = 0;
+        piece_at[square] = 0;
+    }
+
+    void Board::PieceList::MovePiece(uint8_t from, uint8_t to) {
+        uint8_t moved_index = index[from];
+        squares[moved_index] = to;
+        index[to] = moved_index;
+        piece_at[to] = piece_at[from];
+        piece_at[from] = 0;
+    }
+
     Board::Board(const BoardInfo &info) :
             representation_(std::get<Representation>(info)),
             castling_rights_(std::get<CastlingRights>(info)),
@@ -32,12 +91,39 @@ namespace ChessEngine {
             is_flipped_(std::get<Team>(info) == Team::Black)
             {
                 zobrist_key_ = Zobrist::GetZobristKey(*this, is_flipped_);
+                InitPieceList();
+                History::Instance().AddState(move_counters_.ply_counter, zobrist_key_);
             }
 
+    void Board::InitPieceList() {
+        // Make it so own is always white.
+        // Also mirrors the tiles.
+        Representation representation = representation_;
+        if(is_flipped_)
+            representation.Mirror();
+
+        piece_list_ = PieceList();
+        auto update_list = [&] (Bitboard piece_board, PieceType type) {
+            // White first for kings to work.
+            for(auto tile : piece_board & representation.own_pieces)
+                piece_list_.AddPiece(NNUE::GetPieceEncoding(type, White), NNUE::GetSquareEncoding(tile));
+            for(auto tile : piece_board & representation.enemy_pieces)
+                piece_list_.AddPiece(NNUE::GetPieceEncoding(type, Black), NNUE::GetSquareEncoding(tile));
+        };
+
+        update_list(representation.Kings(), King);
+        update_list(representation.Pawns(), Pawn);
+        update_list(representation.Knights(), Knight);
+        update_list(representation.Queens(), Queen);
+        update_list(representation.Rooks(), Rook);
+        update_list(representation.Bishops(), Bishop);
+    }
+
     void Board::Mirror() {
         representation_.Mirror();
         castling_rights_.Mirror();
         is_flipped_ = !is_flipped_;
+        is_attack_info_valid_ = false;
 
         // Incremental update on zobrist key due to black's turn.
         zobrist_key_ ^= Zobrist::GetSideKey();
@@ -46,6 +132,7 @@ namespace ChessEngine {
     void Board::UnPlayMove(Move move, PieceType captured_piece){ // TODO: WIP.
         BoardTile from = move.GetFrom();
         BoardTile to = move.GetTo();
+        is_attack_info_valid_ = false;
 
         representation_.enemy_pieces.Reset(to);
         representation_.enemy_pieces.SetIf(to, captured_piece != PieceType::None);
@@ -79,6 +166,8 @@ namespace ChessEngine {
     }
 
     void Board::PlayNullMove(){
+        is_attack_info_valid_ = false;
+
         // Reset en passant.
         Bitboard previous_enPassant_board = representation_.pawns_enPassant & Masks::rank_8;
         if(!previous_enPassant_board.IsEmpty()) {
@@ -88,23 +177,23 @@ namespace ChessEngine {
         }
         representation_.pawns_enPassant -= Masks::rank_8;
 
-        NNUE::Instance().CopyToNextAccumulator(move_counters_.ply_counter);
-
-        // Update history.
-        History::Element history_element = {.key = zobrist_key_, .progress_made = false};
-        History::Instance().AddState(move_counters_.ply_counter, history_element);
+        NNUE::Instance().InitNullMoveAccumulator(move_counters_.ply_counter);
 
         // Update counters , no move was made so 50 move rule is updated.
         if(is_flipped_)
             move_counters_.full_moves++;
         move_counters_.half_moves = 0;
         move_counters_.ply_counter++;
+
+        // Update history with the key the position has once mirrored.
+        History::Instance().AddState(move_counters_.ply_counter, zobrist_key_ ^ Zobrist::GetSideKey());
     }
 
     void Board::PlayMove(Move move){
         BoardTile from = move.GetFrom();
         BoardTile to = move.GetTo();
         PieceType promotion = move.GetPromotion();
+        is_attack_info_valid_ = false;
 
         uint8_t from_normalised_index = NNUE::GetSquareEncoding(from, is_flipped_);
         uint8_t to_normalised_index = NNUE::GetSquareEncoding(to, is_flipped_);
@@ -123,8 +212,12 @@ namespace ChessEngine {
             enemy_color = Black;
         }
 
-        auto[own_piece_type, own_team] = GetPieceInfoAt(from);
-        assert(own_piece_type != None);
+        // The moved and captured pieces come with the move.
+        PieceType own_piece_type = move.GetMovedPiece();
+        PieceType enemy_piece_type = move.GetCapturedPiece();
+        Move::Flag flag = move.GetFlag();
+        assert(own_piece_type != None && own_piece_type == GetPieceTypeAt(from.GetFile(), from.GetRank()));
+        assert(flag == Move::EnPassant || enemy_piece_type == GetPieceTypeAt(to.GetFile(), to.GetRank()));
         dirty_piece->pc[0] = NNUE::GetPieceEncoding(own_piece_type, own_color);
         dirty_piece->from[0] = from_normalised_index;
         dirty_piece->to[0] = to_normalised_index;
@@ -133,9 +226,9 @@ namespace ChessEngine {
         zobrist_key_ ^= Zobrist::GetPieceSquareKey(own_piece_type, !is_flipped_, from_normalised_index);
         zobrist_key_ ^= Zobrist::GetPieceSquareKey(own_piece_type, !is_flipped_, to_normalised_index);
 
-        if(representation_.enemy_pieces.Get(to)){
+        bool is_capture = enemy_piece_type != None && flag != Move::EnPassant;
+        if(is_capture){
             dirty_piece->dirtyNum = 2;
-            auto[enemy_piece_type, enemy_team] = GetPieceInfoAt(to);
             dirty_piece->pc[1] = NNUE::GetPieceEncoding(enemy_piece_type, enemy_color);
             dirty_piece->from[1] = to_normalised_index;
             dirty_piece->to[1] = REMOVED_SQUARE;
@@ -158,10 +251,10 @@ namespace ChessEngine {
         representation_.pawns_enPassant.Reset(to);
 
         // If there has been a capture.
-        bool reset_50_move_rule = representation_.enemy_pieces.Get(to);
+        bool reset_50_move_rule = is_capture;
 
         // King.
-        if(from == representation_.own_king){
+        if(own_piece_type == King){
             // Incremental update on zobrist key when king moves (or castles).
             // In all the castling updates we have to firstly remove the old rights before
             // xor-ing the new one.
@@ -192,13 +285,12 @@ namespace ChessEngine {
                 representation_.own_pieces.Set(rook_to);
             };
 
-            bool is_castling = abs(from_file - to_file) == 2;
-            bool is_queen_side = is_castling && to == (Masks::queen_rook + 2);
-            bool is_king_side = is_castling && to == (Masks::king_rook - 1);
-            if(is_queen_side)
-                castling(Masks::queen_rook, Masks::queen_rook + 3);
-            else if(is_king_side)
-                castling(Masks::king_rook,  Masks::king_rook - 2);
+            if(flag == Move::Castling){
+                if(to_file < from_file)
+                    castling(Masks::queen_rook, Masks::queen_rook + 3);
+                else
+                    castling(Masks::king_rook,  Masks::king_rook - 2);
+            }
 
             representation_.own_king = to;
         }
@@ -215,18 +307,18 @@ namespace ChessEngine {
             zobrist_key_ ^= Zobrist::GetCastlingKey(castling_rights_, is_flipped_);
         }
         // Pawn.
-        else if(representation_.Pawns().Get(from)) {
+        else if(own_piece_type == Pawn) {
             // Pawn movements reset the rule.
             reset_50_move_rule = true;
 
             // Double pawn push. En passant is set at the 0-th rank.
-            if ((to_rank - from_rank) == 2) {
+            if (flag == Move::DoublePush) {
                 representation_.pawns_enPassant.Set(from_file, 0);
                 // Incremental update on zobrist key when enabling en passant flag.
                 zobrist_key_ ^= Zobrist::GetEnPassantKey(from_file);
             }
             // En passant capture. Fake pawn does not exist. Movement is diagonal.
-            else if (!representation_.enemy_pieces.Get(to) && from_file != to_file) {
+            else if (flag == Move::EnPassant) {
                 // Enemy pawn is one tile below en passant square.
                 BoardTile enemy_pawn = BoardTile(to_file, to_rank - 1);
                 representation_.pawns_enPassant.Reset(enemy_pawn);
@@ -243,7 +335,7 @@ namespace ChessEngine {
                 dirty_piece->to[1] = REMOVED_SQUARE;
             }
             // Promotions.
-            else if(to_rank == Rank::R8){
+            else if(promotion != None){
                 dirty_piece->to[0] = REMOVED_SQUARE;
                 dirty_piece->from[dirty_piece->dirtyNum] = REMOVED_SQUARE;
                 dirty_piece->to[dirty_piece->dirtyNum] = NNUE::GetSquareEncoding(to, is_flipped_);
@@ -319,11 +411,18 @@ namespace ChessEngine {
         representation_.bishop_queens.Reset(from);
         representation_.pawns_enPassant.Reset(from);
 
-        // Update history.
-        History::Element history_element = {.key = zobrist_key_, .progress_made = reset_50_move_rule};
-        History::Instance().AddState(move_counters_.ply_counter, history_element);
-        // Repetitions count.
-        move_counters_.repetitions = StateRepetitions(this->zobrist_key_, move_counters_.ply_counter);
+        // The dirty piece holds every change of the move, captures are removed before
+        // any piece lands on their square.
+        for(int i = 0; i < dirty_piece->dirtyNum; i++){
+            if(dirty_piece->to[i] == REMOVED_SQUARE)
+                piece_list_.RemovePiece(dirty_piece->from[i]);
+        }
+        for(int i = 0; i < dirty_piece->dirtyNum; i++){
+            if(dirty_piece->from[i] == REMOVED_SQUARE)
+                piece_list_.AddPiece(dirty_piece->pc[i], dirty_piece->to[i]);
+            else if(dirty_piece->to[i] != REMOVED_SQUARE)
+                piece_list_.MovePiece(dirty_piece->from[i], dirty_piece->to[i]);
+        }
 
         // Set counters,
         if(is_flipped_)
@@ -337,30 +436,60 @@ namespace ChessEngine {
             move_counters_.half_moves++;
         move_counters_.ply_counter++;
 
+        // Update history with the key the position has once mirrored.
+        // Repetitions are only looked up when needed, not on every move.
+        History::Instance().AddState(move_counters_.ply_counter, zobrist_key_ ^ Zobrist::GetSideKey());
+
         assert(Zobrist::GetZobristKey(*this, is_flipped_) == zobrist_key_);
+        assert(GetPieceTypeAt(to_file, to_rank) == (promotion != None ? promotion : own_piece_type));
     }
 
-    int Board::StateRepetitions(uint64_t zobrist_key, uint8_t ply) const{
-        // If currently made progress , no repetition.
-        // Ply should be equal to the index of the last played move.
-        if(History::Instance().GetState(ply).progress_made)
-            return 0;
-
+    int Board::StateRepetitions() const{
+        // Only positions since the last capture or pawn move can repeat, two plies apart so the same side moves.
+        // The history does not go further back than the position the board was created from.
+        int end = std::min<int>({move_counters_.half_moves, move_counters_.ply_counter, HISTORY_SIZE - 1});
         int repetitions = 0;
-        for (int i = ply - 2; i >= 0; i-=2) {
-            if(History::Instance().GetState(i+1).progress_made)
-                break;
-            auto state = History::Instance().GetState(i);
-            if(state.progress_made)
-                break;
-            if(state.key == zobrist_key) {
+        for (int i = 4; i <= end; i += 2) {
+            if(History::Instance().GetState(move_counters_.ply_counter - i) == zobrist_key_)
                 repetitions++;
-            }
         }
 
         return repetitions;
     }
 
+    bool Board::HasUpcomingRepetition(int ply) const{
+        // A position an odd number of plies back that differs from the current one by a single reversible
+        // move can be reached again with that move, if nothing stands in its way. Only positions after the
+        // root of the search ([ply] plies back) are considered.
+        int end = std::min<int>({move_counters_.half_moves, move_counters_.ply_counter, ply - 1, HISTORY_SIZE - 1});
+        Bitboard all = representation_.own_pieces | representation_.enemy_pieces;
+        for (int i = 3; i <= end; i += 2) {
+            uint64_t key_difference = zobrist_key_ ^ History::Instance().GetState(move_counters_.ply_counter - i);
+
+            PieceType type;
+            uint8_t from, to;
+            if(!Zobrist::GetReversibleMove(key_difference, type, from, to))
+                continue;
+
+            // The tiles are absolute.
+            if(is_flipped_){
+                from ^= 0b111000;
+                to ^= 0b111000;
+            }
+
+            // Leapers are never blocked , sliders need the tiles in between to be empty.
+            if(type == Knight || type == King)
+                return true;
+            Bitboard attacks = type == Rook ? AttackTables::RookAttacks(from, all)
+                    : type == Bishop ? AttackTables::BishopAttacks(from, all)
+                    : AttackTables::QueenAttacks(from, all);
+            if(attacks.Get(to))
+                return true;
+        }
+
+        return false;
+    }
+
     bool Board::IsUnderAttack(BoardTile tile) const{
         // Consider the tile a piece with all the possible moves.
         Bitboard own = representation_.own_pieces;
@@ -387,40 +516,122 @@ namespace ChessEngine {
         return false;
     }
 
-    bool Board::IsInCheck() const{
-        return IsUnderAttack(representation_.own_king);
+    const Board::AttackInfo& Board::GetAttackInfo() const{
+        if(!is_attack_info_valid_) {
+            ComputeAttackInfo();
+            is_attack_info_valid_ = true;
+        }
+        return attack_info_;
     }
 
-    Bitboard Board::GetPins() const{
-        Bitboard pins(0);
+    void Board::ComputeAttackInfo() const{
+        AttackInfo& info = attack_info_;
 
         Bitboard own = representation_.own_pieces;
         Bitboard enemy = representation_.enemy_pieces;
         Bitboard bishops = representation_.bishop_queens;
         Bitboard rooks = representation_.rook_queens;
+        Bitboard knights = representation_.Knights();
+        Bitboard pawns = representation_.Pawns();
         Bitboard all = own | enemy;
 
+        // Checkers. Own king is considered a piece with all the possible moves.
         uint8_t king_index = representation_.own_king.GetIndex();
-        Bitboard rook_pins = AttackTables::RookAttacks(king_index, all) & own;
-        Bitboard rook_rays = AttackTables::RookAttacks(king_index);
-        Bitboard bishop_pins = AttackTables::BishopAttacks(king_index, all) & own;
-        Bitboard bishop_rays = AttackTables::BishopAttacks(king_index);
-
-        for(auto piece : rook_pins){
-            uint8_t pinned_piece_index = piece.GetIndex();
-            auto mask = rook_rays & enemy & rooks;
-            Bitboard rook_attacks = AttackTables::RookAttacks(pinned_piece_index, all) & mask;
-            pins.SetIf(piece, !rook_attacks.IsEmpty());
+        info.checkers = (AttackTables::RookAttacks(king_index, all) & enemy & rooks) |
+                        (AttackTables::BishopAttacks(king_index, all) & enemy & bishops) |
+                        (AttackTables::KnightAttacks(king_index) & enemy & knights) |
+                        (AttackTables::PawnsAttacks(king_index) & enemy & pawns);
+
+        // Own pieces that are the only blocker between a slider of [sliders] and [king_index].
+        auto blockers = [&](uint8_t king_index, Bitboard blocking, Bitboard sliders) {
+            Bitboard result(0);
+            Bitboard rook_mask = AttackTables::RookAttacks(king_index) & sliders & rooks;
+            Bitboard bishop_mask = AttackTables::BishopAttacks(king_index) & sliders & bishops;
+            for(auto piece : AttackTables::RookAttacks(king_index, all) & blocking)
+                result.SetIf(piece, !(AttackTables::RookAttacks(piece.GetIndex(), all) & rook_mask).IsEmpty());
+            for(auto piece : AttackTables::BishopAttacks(king_index, all) & blocking)
+                result.SetIf(piece, !(AttackTables::BishopAttacks(piece.GetIndex(), all) & bishop_mask).IsEmpty());
+            return result;
+        };
+
+        // Evasions. A sliding checker can also be blocked, the attacks of the king and the checker
+        // along their shared line meet on the tiles between them.
+        info.evasions = Bitboard(0);
+        if(info.checkers.Count() == 1){
+            uint8_t checker_index = info.checkers.BitScanForward().GetIndex();
+            auto[king_file, king_rank] = representation_.own_king.GetCoords();
+            auto[checker_file, checker_rank] = BoardTile(checker_index).GetCoords();
+            bool is_straight = king_file == checker_file || king_rank == checker_rank;
+
+            info.evasions = info.checkers;
+            if(is_straight && rooks.Get(checker_index))
+                info.evasions |= AttackTables::RookAttacks(king_index, all) & AttackTables::RookAttacks(checker_index, all);
+            else if(!is_straight && bishops.Get(checker_index))
+                info.evasions |= AttackTables::BishopAttacks(king_index, all) & AttackTables::BishopAttacks(checker_index, all);
         }
 
-        for(auto piece : bishop_pins){
-            uint8_t pinned_piece_index = piece.GetIndex();
-            auto mask = bishop_rays & enemy & bishops;
-            Bitboard rook_attacks = AttackTables::BishopAttacks(pinned_piece_index, all) & mask;
-            pins.SetIf(piece, !rook_attacks.IsEmpty());
+        uint8_t enemy_king_index = representation_.enemy_king.GetIndex();
+        info.pins = blockers(king_index, own, enemy);
+        info.discovered_checks = blockers(enemy_king_index, own, own);
+
+        // Enemy attacks. Enemy pawns move downwards.
+        Bitboard enemy_pawns = pawns & enemy;
+        Bitboard attacks = Bitboard(((enemy_pawns - Masks::file_A).AsInt() >> 9) | ((enemy_pawns - Masks::file_H).AsInt() >> 7));
+        attacks |= AttackTables::KingAttacks(enemy_king_index);
+        for(auto tile : knights & enemy)
+            attacks |= AttackTables::KnightAttacks(tile.GetIndex());
+        Bitboard all_but_king = all - representation_.own_king;
+        for(auto tile : rooks & enemy)
+            attacks |= AttackTables::RookAttacks(tile.GetIndex(), all_but_king);
+        for(auto tile : bishops & enemy)
+            attacks |= AttackTables::BishopAttacks(tile.GetIndex(), all_but_king);
+        info.enemy_attacks = attacks;
+
+        // Check tiles. Own pawns attack upwards so they check from below the enemy king.
+        Bitboard enemy_king = Bitboard(representation_.enemy_king);
+        info.check_tiles[None] = Bitboard(0);
+        info.check_tiles[King] = Bitboard(0);
+        info.check_tiles[Pawn] = Bitboard(((enemy_king - Masks::file_A).AsInt() >> 9) | ((enemy_king - Masks::file_H).AsInt() >> 7));
+        info.check_tiles[Knight] = AttackTables::KnightAttacks(enemy_king_index);
+        info.check_tiles[Bishop] = AttackTables::BishopAttacks(enemy_king_index, all);
+        info.check_tiles[Rook] = AttackTables::RookAttacks(enemy_king_index, all);
+        info.check_tiles[Queen] = info.check_tiles[Bishop] | info.check_tiles[Rook];
+    }
+
+    bool Board::GivesCheck(const Move& move) const{
+        const AttackInfo& info = GetAttackInfo();
+        BoardTile from = move.GetFrom();
+        BoardTile to = move.GetTo();
+        PieceType type = move.GetMovedPiece();
+        PieceType promotion = move.GetPromotion();
+
+        // Castling and en passant move a second piece. They are rare enough to be played on a copy.
+        if(move.GetFlag() == Move::Castling || move.GetFlag() == Move::EnPassant){
+            Board temp = *this;
+            temp.PlayMove(move);
+            temp.Mirror();
+            return temp.IsUnderAttack(temp.representation_.own_king);
+        }
+
+        // Direct check. A promoted piece can see through the tile its pawn left.
+        if(promotion != None){
+            Bitboard all = (representation_.own_pieces | representation_.enemy_pieces) - from;
+            uint8_t to_index = to.GetIndex();
+            Bitboard attacks(0);
+            if(promotion == Knight)
+                attacks = AttackTables::KnightAttacks(to_index);
+            if(promotion == Rook || promotion == Queen)
+                attacks |= AttackTables::RookAttacks(to_index, all);
+            if(promotion == Bishop || promotion == Queen)
+                attacks |= AttackTables::BishopAttacks(to_index, all);
+            if(attacks.Get(representation_.enemy_king))
+                return true;
+        }else if(info.check_tiles[type].Get(to)){
+            return true;
         }
 
-        return pins;
+        // Discovered check.
+        return info.discovered_checks.Get(from) && !IsAligned(representation_.enemy_king, from, to);
     }
 
     bool Board::IsLegalMove(const Move& move, const Bitboard& pins, bool is_in_check) const {
@@ -429,7 +640,7 @@ namespace ChessEngine {
         auto try_move = [=]() {
             Board temp = *this;
             temp.PlayMove(move);
-            return !temp.IsInCheck();
+            return !temp.IsUnderAttack(temp.representation_.own_king);
         };
 
         BoardTile from = move.GetFrom();
@@ -438,71 +649,69 @@ namespace ChessEngine {
         uint8_t from_file = from.GetFile();
         uint8_t to_file = to.GetFile();
 
-        bool is_king = from == representation_.own_king;
-        bool is_castling = is_king && (abs(from_file - to_file) == 2);
-        bool is_enPassant = to_file != from_file &&
-                !representation_.enemy_pieces.Get(to) &&
-                representation_.pawns_enPassant.Get(from);
+        bool is_king = move.GetMovedPiece() == King;
+        bool is_castling = move.GetFlag() == Move::Castling;
+        bool is_enPassant = move.GetFlag() == Move::EnPassant;
 
-        if(is_enPassant)
-            return try_move();
-
-        if(is_in_check){
+        // The king can not step on an attacked tile. The attacks see through the king so it
+        // can not step back along a checking ray either.
+        const Bitboard& enemy_attacks = GetAttackInfo().enemy_attacks;
+        if(is_king){
             if(is_castling)
-                return false;
-            return try_move();
+                return !is_in_check && !enemy_attacks.Get(from + (to_file - from_file) / 2) && !enemy_attacks.Get(to);
+            return !enemy_attacks.Get(to);
         }
 
-        if(is_king){
-            // Check in between tile.
-            if(is_castling && IsUnderAttack(from + (to_file - from_file) / 2))
-                return false;
+        if(is_enPassant)
             return try_move();
-        }
 
-        if(pins.Get(from)) {
-            uint8_t from_rank = from.GetRank();
-            uint8_t to_rank = to.GetRank();
-            auto[king_file, king_rank] = representation_.own_king.GetCoords();
-
-            const int dx_from = from_file - king_file;
-            const int dy_from = from_rank - king_rank;
-            const int dx_to = to_file - king_file;
-            const int dy_to = to_rank - king_rank;
-
-            // The move is legal only if the vector {from-king} is codirectional with
-            // the vector {to-king}. This is checked by comparing the slopes.
-            // dy_from / dx_from = dy_to / dx_to.
-            if (dx_from == 0 || dx_to == 0) {
-                return (dx_from == dx_to);
-            } else {
-                return (dx_from * dy_to == dx_to * dy_from);
-            }
+        if(is_in_check){
+            // Only the king can escape a double check. Pinned pieces can never reach the checking line.
+            const AttackInfo& info = GetAttackInfo();
+            return info.checkers.Count() == 1 && !pins.Get(from) && info.evasions.Get(to);
         }
 
+        if(pins.Get(from))
+            return IsAligned(representation_.own_king, from, to);
+
         return true; // Not pinned , no check. Can freely move.
     }
 
-    MoveList Board::GetLegalQuietMoves(Bitboard pins, bool is_in_check) const {
-        MoveList moves;
-        moves.reserve(60);
-        PseudoMoves::GetQuietMoves(representation_, castling_rights_, moves);
+    template <GenType type>
+    void Board::GenerateMoves(MoveList& moves) const {
+        const AttackInfo& info = GetAttackInfo();
+        bool is_in_check = !info.checkers.IsEmpty();
+        auto first_move = static_cast<MoveList::difference_type>(moves.size());
+        PseudoMoves::Generate<type>(representation_, castling_rights_, info.evasions, moves);
 
-        auto is_illegal = [=](const Move &move) { return !IsLegalMove(move, pins, is_in_check); };
-        moves.erase(std::remove_if(moves.begin(), moves.end(), is_illegal), moves.end());
+        auto is_illegal = [&](const Move &move) { return !IsLegalMove(move, info.pins, is_in_check); };
+        moves.erase(std::remove_if(moves.begin() + first_move, moves.end(), is_illegal), moves.end());
+    }
 
-        return moves;
+    template void Board::GenerateMoves<GenType::Captures>(MoveList& moves) const;
+    template void Board::GenerateMoves<GenType::Quiets>(MoveList& moves) const;
+    template void Board::GenerateMoves<GenType::Evasions>(MoveList& moves) const;
+    template void Board::GenerateMoves<GenType::All>(MoveList& moves) const;
+
+    bool Board::FindLegalMove(uint16_t compressed, Move& move) const {
+        MoveList moves = GetLegalMoves();
+        auto found = std::find_if(moves.begin(), moves.end(), [=](const Move& legal) {
+            return legal.Compress() == compressed;
+        });
+        if(found == moves.end())
+            return false;
+        move = *found;
+        return true;
     }
 
-    MoveList Board::GetLegalCaptures(Bitboard pins, bool is_in_check) const { // TODO : check for possible refactors.
+    MoveList Board::GetLegalMoves() const {
         // Pre allocate vector size (Requires a Move default constructor).
         MoveList moves;
-        moves.reserve(20);
-        PseudoMoves::GetCaptures(representation_, moves);
-
-        auto is_illegal = [=](const Move &move) { return !IsLegalMove(move, pins, is_in_check); };
-        moves.erase(std::remove_if(moves.begin(), moves.end(), is_illegal), moves.end());
-
+        moves.reserve(80);
+        if(IsInCheck())
+            GenerateMoves<GenType::Evasions>(moves);
+        else
+            GenerateMoves<GenType::All>(moves);
         return moves;
     }
 
@@ -512,44 +721,14 @@ namespace ChessEngine {
     }
 
     PieceInfo Board::GetPieceInfoAt(uint8_t file, uint8_t rank) const {
-        PieceType type = GetPieceTypeAt(file, rank);
-
-        Team team;
-        if(representation_.own_pieces.Get(file, rank)){
-            team = White;
-        }else{
-            team = Black;
-        }
-
-        return {type, team};
+        // The mailbox is absolute, own pieces are reported as white.
+        uint8_t piece = piece_list_.piece_at[AbsoluteSquare(file, rank, is_flipped_)];
+        bool is_own = piece != 0 && (piece >= first_black_piece_code) == is_flipped_;
+        return {piece_code_types[piece], is_own ? White : Black};
     }
 
     PieceType Board::GetPieceTypeAt(uint8_t file, uint8_t rank) const {
-        Bitboard pawns = representation_.Pawns();
-        Bitboard knights = representation_.Knights();
-        Bitboard rooks = representation_.Rooks();
-        Bitboard bishops = representation_.Bishops();
-        Bitboard queens = representation_.Queens();
-        Bitboard kings = representation_.Kings();
-
-        PieceType type;
-        if(pawns.Get(file, rank)){
-            type = PieceType::Pawn;
-        } else if(knights.Get(file, rank)){
-            type = PieceType::Knight;
-        } else if(rooks.Get(file, rank)){
-            type = PieceType::Rook;
-        } else if(bishops.Get(file, rank)){
-            type = PieceType::Bishop;
-        } else if(queens.Get(file, rank)){
-            type = PieceType::Queen;
-        } else if(kings.Get(file, rank)) {
-            type = PieceType::King;
-        } else{
-            type = PieceType::None;
-        }
-
-        return type;
+        return piece_code_types[piece_list_.piece_at[AbsoluteSquare(file, rank, is_flipped_)]];
     }
 
     void Board::Draw() const{
@@ -606,7 +785,7 @@ namespace ChessEngine {
 
         // 3 move repetition.
         // If positions has occurred 2 more times.
-        if(move_counters_.repetitions >= 2)
+        if(StateRepetitions() >= 2)
             return GameResult::Draw;
 
         return GameResult::Playing;
@@ -43,8 +43,6 @@ namespace ChessEngine {
         struct MoveCounters{
             // 50 move rule counter.
             uint8_t half_moves = 0;
-            // 3 fold repetition.
-            uint8_t repetitions = 0;
             // Game's plys.
             uint16_t full_moves = 0;
             uint16_t ply_counter = 0;
@@ -82,6 +80,35 @@ namespace ChessEngine {
             uint8_t data_ = 0;
         };
 
+        // Pieces in the input format of the NNUE probe lib, kept in absolute colours and squares
+        // so mirroring the board does not affect it. Index 0 is the white king, index 1 the black king
+        // and the array of pieces is terminated by a 0.
+        // Also holds the piece code of every square (mailbox) for single load piece lookups.
+        struct PieceList{
+            static constexpr int max_pieces = 16 * 2;
+
+            int pieces[max_pieces + 1] = {};
+            int squares[max_pieces] = {};
+            uint8_t index[64] = {}; // Index of each occupied square inside the list.
+            uint8_t piece_at[64] = {}; // Piece code of each square, 0 if empty.
+            uint8_t size = 0;
+
+            void AddPiece(int piece, uint8_t square);
+            void RemovePiece(uint8_t square);
+            void MovePiece(uint8_t from, uint8_t to);
+        };
+
+        // Attacks of the current position. Computed on first use and kept by copies of the board
+        // until a move is played or the board is mirrored, so a node and its parent share the work.
+        struct AttackInfo{
+            Bitboard checkers; // Enemy pieces attacking own king.
+            Bitboard pins; // Own pieces pinned to own king.
+            Bitboard evasions; // Tiles that capture or block a single checker.
+            Bitboard enemy_attacks; // Tiles attacked by the enemy. Sliders see through own king.
+            Bitboard discovered_checks; // Own pieces that uncover a check on the enemy king when they leave the line.
+            Bitboard check_tiles[7]; // Tiles from where each own piece type would attack the enemy king.
+        };
+
         using BoardInfo = std::tuple<Representation, CastlingRights, MoveCounters, Team>;
         explicit Board(const BoardInfo &info);
         Board() = default;
@@ -90,11 +117,19 @@ namespace ChessEngine {
 
         const Representation& GetRepresentation() const { return representation_; }
         const uint16_t GetPlyCounter() const { return move_counters_.ply_counter; }
+        uint8_t GetHalfMoves() const { return move_counters_.half_moves; }
         CastlingRights GetCastlingRights() const { return castling_rights_; }
         uint64_t GetZobristKey() const { return zobrist_key_; }
+        const PieceList& GetPieceList() const { return piece_list_; }
 
-        MoveList GetLegalQuietMoves(Bitboard pins, bool is_in_check) const;
-        MoveList GetLegalCaptures(Bitboard pins, bool is_in_check) const;
+        // Appends the legal moves of [type] to [moves]. Evasions should only be asked for in check.
+        template <GenType type>
+        void GenerateMoves(MoveList& moves) const;
+        // Every legal move, generated as evasions when in check.
+        MoveList GetLegalMoves() const;
+        // Completes a move known only by its from, to and promotion (eg: parsed from uci).
+        // Returns false if it is not a legal move of the position.
+        bool FindLegalMove(uint16_t compressed, Move& move) const;
 
         void PlayMove(Move move); // Plays the move. Does not alter the turn.
         void PlayNullMove();
@@ -109,14 +144,22 @@ namespace ChessEngine {
         PieceInfo GetPieceInfoAt(BoardTile tile) const;
         PieceType GetPieceTypeAt(uint8_t file, uint8_t rank) const;
 
-        Bitboard GetPins() const;
-        bool IsInCheck() const;
+        const AttackInfo& GetAttackInfo() const;
+        Bitboard GetPins() const { return GetAttackInfo().pins; }
+        bool IsInCheck() const { return !GetAttackInfo().checkers.IsEmpty(); }
+        // Tests a legal move of the current position without playing it.
+        bool GivesCheck(const Move& move) const;
+        // If a single reversible move leads back to a position played after the root of the search,
+        // [ply] plies ago. Found through cuckoo tables, see Zobrist::GetReversibleMove.
+        bool HasUpcomingRepetition(int ply) const;
     private:
 
         bool IsLegalMove(const Move& move, const Bitboard& pins, bool is_in_check) const;
         bool IsUnderAttack(BoardTile tile) const;
         bool InsufficientMaterial() const;
-        int StateRepetitions(uint64_t zobrist_key, uint8_t ply) const;
+        int StateRepetitions() const; // Times the current position occurred before.
+        void InitPieceList();
+        void ComputeAttackInfo() const;
 
         Representation representation_;
         CastlingRights castling_rights_;
@@ -125,6 +168,10 @@ namespace ChessEngine {
         // default state corresponds to white.
         bool is_flipped_ = false;
         uint64_t zobrist_key_;
+        PieceList piece_list_;
+
+        mutable AttackInfo attack_info_;
+        mutable bool is_attack_info_valid_ = false;
     };
 
 }
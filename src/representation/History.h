@@ -1,36 +1,36 @@
 #ifndef HISTORY_H
 #define HISTORY_H
 
+// Power of 2. Only positions since the last capture or pawn move are looked up
+// and the 50 move rule keeps them well within this range.
 #define HISTORY_SIZE 256
 
 #include <cstdint>
 #include <array>
 
 namespace ChessEngine {
+    // Zobrist keys of the played positions indexed by the ply counter of the board.
+    // Ring buffer so long games keep overwriting the oldest positions.
+    // Every thread has its own history so searches can run in parallel.
     class History {
     public:
-        struct Element {
-            uint64_t key; // Zobrist key
-            bool progress_made; // If capture or pawn move.
-        };
-
         static History& Instance(){
-            static History history;
+            static thread_local History history;
             return history;
         }
 
-        void AddState(uint8_t ply, Element element){
-            data_[ply] = element;
+        void AddState(uint16_t ply, uint64_t key){
+            data_[ply & (HISTORY_SIZE - 1)] = key;
         }
 
-        Element GetState(uint8_t ply){
-            return data_[ply];
+        uint64_t GetState(uint16_t ply) const{
+            return data_[ply & (HISTORY_SIZE - 1)];
         }
 
     private:
         History() = default;
-        std::array<Element, HISTORY_SIZE> data_;
+        std::array<uint64_t, HISTORY_SIZE> data_{};
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,136 +1,802 @@
 #include "MCTS.h"
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <representation/History.h>
+#include <search/NNUE.h>
+#include <search/Playout.h>
+
+// Upper bound of the legal moves of a position , room an expansion needs in the arena.
+#define MCTS_MAX_CHILDREN 256
+// Loss added to the nodes a sample goes through until its result is back propagated,
+// so the other threads pick different paths.
+#define MCTS_VIRTUAL_LOSS 1.0f
+// Entries looked at from the home slot of a position in the shared statistics table.
+#define MCTS_SHARED_PROBES 8
 
 namespace ChessEngine::MCTS {
-    namespace {
-        struct Node {
-            bool is_terminal;
-            float score{};
-            int visits{};
-            Board state;
-            Move move;
-            std::vector<Node> children;
-
-            Node(Board board, bool is_terminal, Move move = Move()) {
-                this->state = board;
-                this->is_terminal = is_terminal;
-                this->move = move;
+    enum class NodeState : uint8_t {
+        Leaf, Expanding, Expanded
+    };
+
+    // Statistics of a position pooled by the nodes that reach it through different move orders.
+    struct SharedStats {
+        std::atomic<uint64_t> key = 0; // Zero while the entry is free.
+        std::atomic<float> score = 0; // Sum of the results for the side that moved into the position.
+        std::atomic<uint32_t> visits = 0;
+    };
+
+    // Bounded table of shared statistics keyed by zobrist key. Entries are claimed once and never replaced
+    // so a node can keep the index of its entry , positions met once it is full only use their node statistics.
+    class SharedTable {
+    public:
+        static constexpr uint32_t Unknown = 0; // Index of a node not looked up yet , entry 0 is never used.
+        static constexpr uint32_t None = UINT32_MAX; // No entry was free.
+
+        explicit SharedTable(size_t capacity) : capacity_(capacity > 1 ? std::min<size_t>(capacity, None) : 0) {
+            if (capacity_ == 0)
+                return;
+            AlignedReserve<SharedStats>(entries_, capacity_);
+            for (size_t i = 0; i < capacity_; i++) {
+                new (&entries_[i]) SharedStats();
             }
-        };
+        }
+        ~SharedTable() { AlignedFree(entries_); }
+        SharedTable(const SharedTable&) = delete;
+        SharedTable& operator=(const SharedTable&) = delete;
 
-        float UCT(const Node &node, Node *parent) {
-            static float c = 1;
-            static float e = 1;
+        bool IsEnabled() const { return capacity_ > 0; }
+        SharedStats& operator[](uint32_t index) { return entries_[index]; }
+        size_t Used() const { return used_.load(std::memory_order_relaxed); }
+        uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
 
-            int parent_visits = 0;
-            if (parent) {
-                for (auto &child : parent->children) {
-                    parent_visits += child.visits;
+        // Index of the entry of [key] , claimed if the position is new. None if no probed entry is free.
+        uint32_t Find(uint64_t key) {
+            uint32_t index = 1 + key % (capacity_ - 1);
+            for (int probe = 0; probe < MCTS_SHARED_PROBES; probe++) {
+                uint64_t expected = 0;
+                if (entries_[index].key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+                    used_.fetch_add(1, std::memory_order_relaxed);
+                    return index;
+                }
+                if (expected == key) {
+                    hits_.fetch_add(1, std::memory_order_relaxed);
+                    return index;
                 }
+                index = index + 1 == capacity_ ? 1 : index + 1;
             }
-            parent_visits -= node.visits;
+            return None;
+        }
+
+    private:
+        SharedStats* entries_ = nullptr;
+        size_t capacity_;
+        std::atomic<size_t> used_ = 0;
+        std::atomic<uint64_t> hits_ = 0;
+    };
 
-            return node.score / (e + node.visits) + c * sqrtf(logf(e + parent_visits) / (e + node.visits));
+    // Nodes only keep the move that leads to them, positions are replayed from the root.
+    // Statistics are atomics so threads update them without locks.
+    struct Node {
+        Move move;
+        std::atomic<float> score = 0; // Sum of the results for the side that played [move].
+        std::atomic<uint32_t> visits = 0;
+        uint32_t first_child = 0; // Arena index , the children of a node are contiguous.
+        std::atomic<uint32_t> entry = SharedTable::Unknown; // Shared statistics of the position, set on the first visit.
+        uint16_t child_count = 0;
+        std::atomic<NodeState> state = NodeState::Leaf; // Children are set before it becomes Expanded.
+        std::atomic<Proof> proof = Proof::None; // For the side to move , terminal positions are proven leaves.
+
+        Node() = default;
+        // Only used to compact the arena, no thread is sampling then.
+        Node& operator=(const Node& node) {
+            move = node.move;
+            score.store(node.score.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            visits.store(node.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            first_child = node.first_child;
+            child_count = node.child_count;
+            entry.store(node.entry.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            state.store(node.state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            proof.store(node.proof.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    // Nodes are allocated from a fixed capacity arena so they never move while samples hold their indices.
+    // Once full, the children of rarely visited nodes are freed and the arena compacted (see Recycle).
+    class Tree {
+    public:
+        Tree(size_t capacity, size_t shared_capacity) :
+                capacity_(std::max<size_t>(capacity, 2 * MCTS_MAX_CHILDREN)), shared_(shared_capacity) {
+            // Pages are only touched once nodes are allocated.
+            AlignedReserve<Node>(nodes_, capacity_);
+            new (&nodes_[0]) Node(); // Root.
         }
+        ~Tree() { AlignedFree(nodes_); }
+        Tree(const Tree&) = delete;
+        Tree& operator=(const Tree&) = delete;
 
-        int Rollout(Board board, bool for_white) {
-            int modifier = for_white ? 1 : -1;
-            while (true) {
-                ChessEngine::Bitboard pins = board.GetPins();
-                bool is_in_check = board.IsInCheck();
-                auto moves = board.GetLegalCaptures(pins, is_in_check);
-                auto quiet_moves = board.GetLegalQuietMoves(pins, is_in_check);
-                moves.insert(moves.end(), quiet_moves.begin(), quiet_moves.end());
+        Node& operator[](uint32_t index) { return nodes_[index]; }
+        // Recycling frees nodes but keeps the shared statistics, positions found again get them back.
+        SharedTable& Shared() { return shared_; }
+        size_t Size() const { return std::min<size_t>(size_.load(std::memory_order_relaxed), capacity_); }
+        int Recycles() const { return recycles_; }
+        bool IsFull() const { return size_.load(std::memory_order_relaxed) + MCTS_MAX_CHILDREN > capacity_; }
 
-                ChessEngine::GameResult result = board.Result(moves);
-                if (result != ChessEngine::GameResult::Playing) {
-                    if (board.IsFlipped())
-                        board.Mirror();
-                    if (result == ChessEngine::GameResult::WhiteWon) {
-                        return 1 * modifier;
-                    } else if (result == ChessEngine::GameResult::BlackWon) {
-                        return -1 * modifier;
-                    } else {
-                        return 0;
-                    }
+        // Called by the thread that moved [parent] to Expanding. Returns false if the arena is full.
+        bool Expand(uint32_t parent, const MoveList& moves) {
+            assert(moves.size() <= MCTS_MAX_CHILDREN);
+            uint32_t first_child = size_.fetch_add(moves.size(), std::memory_order_relaxed);
+            if (first_child + moves.size() > capacity_)
+                return false;
+
+            for (size_t i = 0; i < moves.size(); i++) {
+                new (&nodes_[first_child + i]) Node();
+                nodes_[first_child + i].move = moves[i];
+            }
+            nodes_[parent].first_child = first_child;
+            nodes_[parent].child_count = moves.size();
+            nodes_[parent].state.store(NodeState::Expanded, std::memory_order_release);
+            return true;
+        }
+
+        // Frees the children of the nodes visited less than a threshold, they get expanded again if the
+        // search comes back to them. The threshold doubles until at most half of the arena is kept.
+        // Invalidates every index but the root's, no other thread may be sampling.
+        void Recycle() {
+            uint32_t min_visits = 2;
+            while (CountKept(min_visits) > capacity_ / 2)
+                min_visits *= 2;
+
+            Compact(min_visits);
+            recycles_++;
+        }
+
+        // Makes the node at [index] the root and frees everything outside of its subtree.
+        // No other thread may be sampling.
+        void Reroot(uint32_t index) {
+            nodes_[0] = nodes_[index];
+            Compact(0);
+        }
+
+    private:
+        // Keeps the children of the expanded nodes reachable from the root and visited at least [min_visits] times.
+        void Compact(uint32_t min_visits) {
+            // Nodes whose children are kept.
+            std::vector<uint32_t> owners;
+            std::vector<uint32_t> stack = {0};
+            while (!stack.empty()) {
+                Node& node = nodes_[stack.back()];
+                uint32_t index = stack.back();
+                stack.pop_back();
+                if (node.state != NodeState::Expanded)
+                    continue;
+
+                if (node.visits < min_visits) {
+                    node.state = NodeState::Leaf;
+                    node.child_count = 0;
+                    continue;
                 }
+                owners.push_back(index);
+                for (uint32_t i = 0; i < node.child_count; i++) {
+                    stack.push_back(node.first_child + i);
+                }
+            }
 
-                ChessEngine::Move move = moves[rand() % moves.size()];
+            // Children are allocated after their parent, moving the kept blocks down in allocation
+            // order never overwrites a block that still has to be moved.
+            std::sort(owners.begin(), owners.end(), [&](uint32_t a, uint32_t b) {
+                return nodes_[a].first_child < nodes_[b].first_child;
+            });
+            std::vector<uint32_t> old_first(owners.size());
+            std::vector<uint32_t> new_first(owners.size());
+            uint32_t end = 1;
+            for (size_t i = 0; i < owners.size(); i++) {
+                // The owner was already moved with the block it belongs to, unless it is the root.
+                uint32_t owner = owners[i];
+                if (owner != 0) {
+                    size_t block = std::upper_bound(old_first.begin(), old_first.begin() + i, owner) - old_first.begin() - 1;
+                    owner = owner - old_first[block] + new_first[block];
+                }
+
+                Node& node = nodes_[owner];
+                old_first[i] = node.first_child;
+                new_first[i] = end;
+                std::copy(nodes_ + node.first_child, nodes_ + node.first_child + node.child_count, nodes_ + end);
+                node.first_child = end;
+                end += node.child_count;
+            }
+            size_.store(end);
+        }
+
+        size_t CountKept(uint32_t min_visits) const {
+            size_t count = 1;
+            std::vector<uint32_t> stack = {0};
+            while (!stack.empty()) {
+                const Node& node = nodes_[stack.back()];
+                stack.pop_back();
+                if (node.state != NodeState::Expanded || node.visits < min_visits)
+                    continue;
+
+                count += node.child_count;
+                for (uint32_t i = 0; i < node.child_count; i++) {
+                    stack.push_back(node.first_child + i);
+                }
+            }
+            return count;
+        }
+
+        Node* nodes_;
+        size_t capacity_;
+        SharedTable shared_;
+        std::atomic<size_t> size_ = 1;
+        int recycles_ = 0;
+    };
+
+    namespace {
+        uint32_t SelectChild(Tree& tree, uint32_t parent) {
+            static float c = 1;
+            static float e = 1;
+
+            // The parent's visits are the sum of its children's (plus its own expansion).
+            const Node& node = tree[parent];
+            float log_parent_visits = logf(e + node.visits.load(std::memory_order_relaxed));
+
+            // Proven children are not sampled anymore. If all of them are, the parent is proven too
+            // (or about to be by another thread) and the first child stops the selection.
+            float max_uct = -INFINITY;
+            uint32_t max_uct_index = node.first_child;
+            for (uint32_t index = node.first_child; index < node.first_child + node.child_count; index++) {
+                const Node& child = tree[index];
+                if (child.proof.load(std::memory_order_relaxed) != Proof::None)
+                    continue;
+                float visits = child.visits.load(std::memory_order_relaxed);
+                float score = child.score.load(std::memory_order_relaxed);
+                float mean = score / (e + visits);
+                // The value of a transposed position pools every path to it , the exploration stays per move.
+                uint32_t entry = child.entry.load(std::memory_order_relaxed);
+                if (entry != SharedTable::Unknown && entry != SharedTable::None) {
+                    const SharedStats& shared = tree.Shared()[entry];
+                    mean = shared.score.load(std::memory_order_relaxed) / (e + shared.visits.load(std::memory_order_relaxed));
+                }
+                float uct_score = mean + c * sqrtf(log_parent_visits / (e + visits));
+                if (uct_score > max_uct) {
+                    max_uct = uct_score;
+                    max_uct_index = index;
+                }
+            }
+            return max_uct_index;
+        }
+
+        // Win probability of a score mapped to a result between -1 (lost) and 1 (won).
+        float ScoreToResult(int score) {
+            return 2.0f / (1.0f + expf(-score / MCTS_SCORE_SCALE)) - 1.0f;
+        }
+
+        // Random moves until the end of the game or [max_plies], then the static evaluation. The moves are picked
+        // by Playout::RandomMoves and only the picked ones are played through Board, for the NNUE.
+        // Result for the side to move of [board].
+        float ShortPlayout(Board board, int max_plies) {
+            static thread_local MoveList moves;
+            moves.clear();
+            float result;
+            if (Playout::RandomMoves(board, max_plies, moves, result))
+                return result;
+
+            for (auto move : moves) {
                 board.PlayMove(move);
                 board.Mirror();
             }
+            float sign = moves.size() % 2 ? -1 : 1;
+            return sign * ScoreToResult(NNUE::Evaluate(board));
         }
 
-        float Sample(Node &node, bool for_white) {
-            node.visits++;
-            if (node.children.empty()) {
-                if (node.is_terminal)
-                    return 0;
+        // Result for the side to move of a leaf that is not terminal.
+        float EvaluateLeaf(const Board& board, const Options& options) {
+            switch (options.leaf_evaluation) {
+                case LeafEvaluation::Rollout:
+                    return Playout::RandomGame(board, options.rollout_plies);
+                case LeafEvaluation::Evaluate:
+                    return ScoreToResult(NNUE::Evaluate(board));
+                case LeafEvaluation::QSearch:
+                    return ScoreToResult(QSearch(board, -INT16_MAX, INT16_MAX));
+                case LeafEvaluation::Playout:
+                    return ShortPlayout(board, options.playout_plies);
+            }
+            return 0;
+        }
 
-                // Expansion phase.
-                const Board &board = node.state;
+        // Shared statistics of the position of [node] , [board]. Null if the table is disabled or full.
+        SharedStats* FindShared(Tree& tree, Node& node, const Board& board) {
+            if (!tree.Shared().IsEnabled())
+                return nullptr;
 
-                Bitboard pins = board.GetPins();
-                bool is_in_check = board.IsInCheck();
-                MoveList moves = board.GetLegalCaptures(pins, is_in_check);
-                MoveList quiet_moves = board.GetLegalQuietMoves(pins, is_in_check);
-                moves.insert(moves.end(), quiet_moves.begin(), quiet_moves.end());
+            // Every thread reaching the node keeps the first index set , back propagation reads it again.
+            uint32_t entry = node.entry.load(std::memory_order_relaxed);
+            if (entry == SharedTable::Unknown) {
+                uint32_t found = tree.Shared().Find(board.GetZobristKey());
+                entry = SharedTable::Unknown;
+                if (node.entry.compare_exchange_strong(entry, found, std::memory_order_relaxed))
+                    entry = found;
+            }
+            return entry == SharedTable::None ? nullptr : &tree.Shared()[entry];
+        }
 
-                for (const Move &move : moves) {
-                    Board temp = board;
-                    temp.PlayMove(move);
-                    temp.Mirror();
+        // Result for the side to move of a proven node. Returns false if the node is not proven.
+        bool ProvenResult(Proof proof, float& result) {
+            switch (proof) {
+                case Proof::Win: result = 1; return true;
+                case Proof::Loss: result = -1; return true;
+                case Proof::Draw: result = 0; return true;
+                default: return false;
+            }
+        }
 
-                    ChessEngine::GameResult result = board.Result(moves);
-                    bool terminal = result != GameResult::Playing;
+        // Selection and expansion phases. Returns true if the leaf is terminal and sets its [result] , otherwise
+        // [board] is the position of the leaf that still has to be evaluated.
+        bool SelectLeaf(Tree& tree, const Board& root, Board& board, std::vector<uint32_t>& path, float& result) {
+            board = root;
+            path.clear();
+            path.push_back(0);
+            tree[0].visits.fetch_add(1, std::memory_order_relaxed);
 
-                    Node new_node(temp, terminal, move);
-                    node.children.push_back(new_node);
+            // Selection phase. Nodes count as visited and lost until the result is back propagated.
+            while (tree[path.back()].state.load(std::memory_order_acquire) == NodeState::Expanded &&
+                   tree[path.back()].proof.load(std::memory_order_acquire) == Proof::None) {
+                uint32_t index = SelectChild(tree, path.back());
+                Node& child = tree[index];
+                board.PlayMove(child.move);
+                board.Mirror();
+                child.visits.fetch_add(1, std::memory_order_relaxed);
+                child.score.fetch_sub(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+                if (SharedStats* shared = FindShared(tree, child, board)) {
+                    shared->visits.fetch_add(1, std::memory_order_relaxed);
+                    shared->score.fetch_sub(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
                 }
+                path.push_back(index);
+            }
+
+            // Result for the side to move at the leaf. Terminal, or proven by another thread since it was selected.
+            Node& leaf = tree[path.back()];
+            if (ProvenResult(leaf.proof.load(std::memory_order_acquire), result))
+                return true;
+
+            // Expansion phase.
+            MoveList moves = board.GetLegalMoves();
+            GameResult game_result = board.Result(moves);
+            if (game_result != GameResult::Playing) {
+                // A game can only be lost by the side to move.
+                leaf.proof.store(game_result == GameResult::Draw ? Proof::Draw : Proof::Loss, std::memory_order_release);
+                ProvenResult(leaf.proof.load(std::memory_order_relaxed), result);
+                return true;
+            }
 
-                // Rollout phase.
-                int score;
-                GetBestMove(board, 3, score);
+            // Only one thread expands a leaf, the others reaching it meanwhile only evaluate it.
+            NodeState expected = NodeState::Leaf;
+            if (leaf.state.compare_exchange_strong(expected, NodeState::Expanding, std::memory_order_acq_rel)) {
+                if (!tree.Expand(path.back(), moves))
+                    leaf.state.store(NodeState::Leaf, std::memory_order_release);
+            }
+            return false;
+        }
+
+        // MCTS-solver. From the leaf up, a node is won if a move leads to a position lost by the opponent,
+        // lost if every move leads to a position won by the opponent and drawn if every move is proven
+        // and the best ones draw.
+        void PropagateProof(Tree& tree, const std::vector<uint32_t>& path) {
+            for (size_t i = path.size() - 1; i > 0; i--) {
+                Proof child_proof = tree[path[i]].proof.load(std::memory_order_acquire);
+                Node& parent = tree[path[i - 1]];
+                if (child_proof == Proof::None || parent.proof.load(std::memory_order_acquire) != Proof::None)
+                    return;
 
-                float rollout_result = Rollout(board, for_white);
-                node.score += rollout_result;
-                return rollout_result;
-            } else {
-                // Selection phase.
-                float max_uct = INT32_MIN;
-                Node *max_uct_node = nullptr;
-                for (auto &child : node.children) {
-                    float uct_score = UCT(child, &node);
-                    if (uct_score > max_uct) {
-                        max_uct = uct_score;
-                        max_uct_node = &child;
+                Proof proof = Proof::Loss;
+                for (uint32_t child = parent.first_child; child < parent.first_child + parent.child_count; child++) {
+                    Proof sibling_proof = tree[child].proof.load(std::memory_order_acquire);
+                    if (sibling_proof == Proof::Loss) {
+                        proof = Proof::Win;
+                        break;
+                    } else if (sibling_proof == Proof::None) {
+                        proof = Proof::None;
+                    } else if (sibling_proof == Proof::Draw && proof == Proof::Loss) {
+                        proof = Proof::Draw;
                     }
                 }
+                if (proof == Proof::None)
+                    return;
+                parent.proof.store(proof, std::memory_order_release);
+            }
+        }
 
-                // Back propagate.
-                node.score += Sample(*max_uct_node, for_white);
+        // Alternating sides, [result] is for the side to move at the leaf. The virtual loss is given back.
+        void BackPropagate(Tree& tree, const std::vector<uint32_t>& path, float result) {
+            PropagateProof(tree, path);
+            for (size_t i = path.size() - 1; i > 0; i--) {
+                Node& node = tree[path[i]];
+                node.score.fetch_add(MCTS_VIRTUAL_LOSS - result, std::memory_order_relaxed);
+                uint32_t entry = node.entry.load(std::memory_order_relaxed);
+                if (entry != SharedTable::Unknown && entry != SharedTable::None)
+                    tree.Shared()[entry].score.fetch_add(MCTS_VIRTUAL_LOSS - result, std::memory_order_relaxed);
+                result = -result;
+            }
+        }
+
+        // Move choice. A proven win if there is one, otherwise the most visited move that is not proven lost
+        // unless a proven draw is better than its value.
+        uint32_t BestChild(Tree& tree, uint32_t parent) {
+            const Node& node = tree[parent];
+            uint32_t most_visited = node.first_child;
+            uint32_t best_unproven = UINT32_MAX;
+            uint32_t draw = UINT32_MAX;
+            for (uint32_t index = node.first_child; index < node.first_child + node.child_count; index++) {
+                Proof proof = tree[index].proof.load(std::memory_order_relaxed);
+                uint32_t visits = tree[index].visits.load(std::memory_order_relaxed);
+                if (proof == Proof::Loss)
+                    return index;
+                if (proof == Proof::Draw)
+                    draw = index;
+                if (visits > tree[most_visited].visits.load(std::memory_order_relaxed))
+                    most_visited = index;
+                if (proof == Proof::None && (best_unproven == UINT32_MAX || visits > tree[best_unproven].visits.load(std::memory_order_relaxed)))
+                    best_unproven = index;
             }
 
-            return node.score;
+            if (best_unproven != UINT32_MAX) {
+                const Node& best = tree[best_unproven];
+                if (draw != UINT32_MAX && best.score.load(std::memory_order_relaxed) < 0)
+                    return draw;
+                return best_unproven;
+            }
+            // Every move loses.
+            return draw != UINT32_MAX ? draw : most_visited;
         }
+
+        void Sample(Tree& tree, const Board& root, const Options& options, Board& board, std::vector<uint32_t>& path) {
+            // Only the captures search evaluates incrementally , it updates the accumulators from the root's.
+            if (options.leaf_evaluation == LeafEvaluation::QSearch)
+                NNUE::Instance().ResetAccumulator(root);
+
+            float result;
+            if (!SelectLeaf(tree, root, board, path, result))
+                result = EvaluateLeaf(board, options); // Evaluation phase.
+            BackPropagate(tree, path, result);
+        }
+
+        struct LeafRequest {
+            Board board;
+            std::vector<uint32_t> path;
+            std::chrono::steady_clock::time_point enqueue_time;
+        };
+
+        // Leaves selected by the sampling threads, waiting for a batched evaluation.
+        class LeafQueue {
+        public:
+            explicit LeafQueue(size_t depth) : depth_(depth) {}
+
+            // Waits while the queue is full.
+            void Push(LeafRequest&& request) {
+                std::unique_lock lock(mutex_);
+                not_full_.wait(lock, [&](){ return requests_.size() < depth_; });
+                requests_.push_back(std::move(request));
+                if (requests_.size() >= batch_size_)
+                    not_empty_.notify_one();
+            }
+
+            // Waits for [batch_size] requests, or any once flushing. Returns false once closed and empty.
+            bool Pop(std::vector<LeafRequest>& batch, size_t batch_size) {
+                std::unique_lock lock(mutex_);
+                batch_size_ = batch_size;
+                not_empty_.wait(lock, [&](){
+                    return requests_.size() >= batch_size || ((flush_ || closed_) && !requests_.empty()) || closed_;
+                });
+                if (requests_.empty())
+                    return false;
+
+                batch.clear();
+                while (!requests_.empty() && batch.size() < batch_size) {
+                    batch.push_back(std::move(requests_.front()));
+                    requests_.pop_front();
+                }
+                not_full_.notify_all();
+                return true;
+            }
+
+            // Partial batches are evaluated while flushing, so no leaf waits for requests that will not come.
+            void SetFlush(bool flush) {
+                std::lock_guard lock(mutex_);
+                flush_ = flush;
+                not_empty_.notify_one();
+            }
+
+            void Close() {
+                std::lock_guard lock(mutex_);
+                closed_ = true;
+                not_empty_.notify_one();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable not_full_;
+            std::condition_variable not_empty_;
+            std::deque<LeafRequest> requests_;
+            size_t depth_;
+            size_t batch_size_ = 1;
+            bool flush_ = false;
+            bool closed_ = false;
+        };
+
+        // Bucket i counts the values in [2^i , 2^(i+1)).
+        void AddToHistogram(std::array<uint64_t, 32>& histogram, uint64_t value) {
+            int bucket = 0;
+            while (value > 1 && bucket < 31) {
+                value >>= 1;
+                bucket++;
+            }
+            histogram[bucket]++;
+        }
+    }
+
+    bool ParseLeafEvaluation(const std::string& name, LeafEvaluation& leaf_evaluation){
+        if (name == "rollout") {
+            leaf_evaluation = LeafEvaluation::Rollout;
+        } else if (name == "eval") {
+            leaf_evaluation = LeafEvaluation::Evaluate;
+        } else if (name == "qsearch") {
+            leaf_evaluation = LeafEvaluation::QSearch;
+        } else if (name == "playout") {
+            leaf_evaluation = LeafEvaluation::Playout;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    Searcher::Searcher(const Options& options) : options_(options) {}
+
+    Searcher::~Searcher() = default;
+
+    void Searcher::SetOptions(const Options& options) {
+        if (options.tree_mb != options_.tree_mb || options.shared_mb != options_.shared_mb)
+            Clear();
+        options_ = options;
+    }
+
+    void Searcher::Clear() {
+        tree_.reset();
+    }
+
+    bool Searcher::Reroot(const Board& state) {
+        uint64_t key = state.GetZobristKey();
+        if (root_.GetZobristKey() == key && root_.GetPlyCounter() == state.GetPlyCounter())
+            return true;
+        if (state.GetPlyCounter() != root_.GetPlyCounter() + 1 && state.GetPlyCounter() != root_.GetPlyCounter() + 2)
+            return false;
+
+        // Replaying the moves writes the history and accumulators of the plies of [state].
+        History history = History::Instance();
+        Tree& tree = *tree_;
+        uint32_t new_root = 0;
+        std::vector<std::pair<uint32_t, Board>> stack = {{0, root_}};
+        while (!stack.empty() && new_root == 0) {
+            auto [index, board] = stack.back();
+            stack.pop_back();
+            if (tree[index].state != NodeState::Expanded || board.GetPlyCounter() >= state.GetPlyCounter())
+                continue;
+
+            for (uint32_t child = tree[index].first_child; child < tree[index].first_child + tree[index].child_count; child++) {
+                Board child_board = board;
+                child_board.PlayMove(tree[child].move);
+                child_board.Mirror();
+                if (child_board.GetPlyCounter() == state.GetPlyCounter() && child_board.GetZobristKey() == key) {
+                    new_root = child;
+                    break;
+                }
+                stack.emplace_back(child, child_board);
+            }
+        }
+        History::Instance() = history;
+        NNUE::Instance().ResetAccumulator(state);
+
+        if (new_root == 0)
+            return false;
+        tree.Reroot(new_root);
+        return true;
     }
 
-    Move Search(const Board& state, int iterations, bool for_white){
-        Node root(state, false);
-        for (int i = 0; i < iterations; i++) {
-            Sample(root, for_white);
+    void Searcher::FillStats(Stats& stats) const {
+        Tree& tree = *tree_;
+        stats.tree_nodes = tree.Size();
+        stats.recycles = tree.Recycles();
+        stats.shared_entries = tree.Shared().Used();
+        stats.shared_hits = tree.Shared().Hits();
+
+        stats.proof = tree[0].proof.load(std::memory_order_relaxed);
+        stats.best_line.clear();
+        stats.value = 0;
+        uint32_t index = 0;
+        while (tree[index].state.load(std::memory_order_acquire) == NodeState::Expanded) {
+            uint32_t best_child = BestChild(tree, index);
+            uint32_t visits = tree[best_child].visits.load(std::memory_order_relaxed);
+            if (visits == 0)
+                break;
+            if (index == 0) {
+                // The proof of the child is for the opponent.
+                float result;
+                if (ProvenResult(tree[best_child].proof.load(std::memory_order_relaxed), result))
+                    stats.value = -result;
+                else
+                    stats.value = tree[best_child].score.load(std::memory_order_relaxed) / visits;
+            }
+            stats.best_line.push_back(tree[best_child].move);
+            index = best_child;
         }
+    }
+
+    Move Searcher::Search(const Board& state, const Limits& limits, Stats* stats,
+                          const std::function<void(const Stats&)>& on_info) {
+        auto start = std::chrono::steady_clock::now();
+        if (!tree_ || !Reroot(state))
+            tree_ = std::make_unique<Tree>(size_t(options_.tree_mb) * 1024 * 1024 / sizeof(Node),
+                                           size_t(options_.shared_mb) * 1024 * 1024 / sizeof(SharedStats));
+        root_ = state;
+        Tree& tree = *tree_;
+        // A proven root whose children were recycled is searched again , its move is not known anymore.
+        if (tree[0].state.load(std::memory_order_relaxed) != NodeState::Expanded)
+            tree[0].proof.store(Proof::None, std::memory_order_relaxed);
+        // A finished game is proven before any sample , there is no move to search.
+        GameResult root_result = state.Result(state.GetLegalMoves());
+        if (root_result != GameResult::Playing)
+            tree[0].proof.store(root_result == GameResult::Draw ? Proof::Draw : Proof::Loss, std::memory_order_relaxed);
+        const Options& options = options_;
+
+        int iterations = limits.iterations;
+        if (iterations == 0 && limits.time_ms == 0)
+            iterations = MCTS_DEFAULT_ITERATIONS;
+
+        // Samples hold the lock shared, recycling the tree waits for them to end.
+        std::shared_mutex recycle_mutex;
+        std::atomic<int> samples = 0;
+        std::atomic<bool> stop = false;
+        // Positions played before the root, for the repetitions of the helper threads.
+        History history = History::Instance();
+
+        // Batched evaluation. Leaves are queued until evaluated, their indices must stay valid meanwhile.
+        bool is_batched = options.batch_size > 0;
+        LeafQueue queue(std::max(options.queue_depth, options.batch_size));
+        std::atomic<int> pending_leaves = 0;
+        std::array<uint64_t, 32> batch_size_histogram = {};
+        std::array<uint64_t, 32> latency_histogram = {};
+
+        auto elapsed_ms = [&](){
+            return int(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        };
 
-        int max = INT32_MIN;
-        Move best_move;
-        for (const auto& child : root.children) {
-            if(child.visits > max){
-                max = child.visits;
-                best_move = child.move;
+        auto worker = [&](bool is_main){
+            History::Instance() = history;
+            Board board;
+            std::vector<uint32_t> path;
+            int next_info_ms = MCTS_INFO_INTERVAL_MS;
+            // Nothing is left to sample once the root is proven.
+            while (!stop.load(std::memory_order_relaxed) && tree[0].proof.load(std::memory_order_relaxed) == Proof::None) {
+                int sample = samples.fetch_add(1, std::memory_order_relaxed);
+                if (iterations > 0 && sample >= iterations)
+                    break;
+
+                // The main thread watches the clock.
+                if (is_main && sample % 64 == 0) {
+                    int ms = elapsed_ms();
+                    if (limits.time_ms > 0 && ms >= limits.time_ms) {
+                        stop = true;
+                        break;
+                    }
+                    if (on_info && ms >= next_info_ms) {
+                        Stats info;
+                        info.iterations = sample;
+                        info.time_ms = ms;
+                        {
+                            std::shared_lock lock(recycle_mutex);
+                            FillStats(info);
+                        }
+                        on_info(info);
+                        next_info_ms = ms + MCTS_INFO_INTERVAL_MS;
+                    }
+                }
+
+                if (tree.IsFull()) {
+                    std::unique_lock lock(recycle_mutex);
+                    if (tree.IsFull()) {
+                        // Queued leaves are evaluated first.
+                        queue.SetFlush(true);
+                        while (pending_leaves.load() > 0)
+                            std::this_thread::yield();
+                        queue.SetFlush(false);
+                        tree.Recycle();
+                    }
+                }
+
+                std::shared_lock lock(recycle_mutex);
+                if (!is_batched) {
+                    Sample(tree, state, options, board, path);
+                    continue;
+                }
+
+                float result;
+                if (SelectLeaf(tree, state, board, path, result)) {
+                    BackPropagate(tree, path, result);
+                } else {
+                    pending_leaves++;
+                    queue.Push({board, path, std::chrono::steady_clock::now()});
+                }
             }
+        };
+
+        auto evaluator = [&](){
+            std::vector<LeafRequest> batch;
+            std::vector<Board> boards;
+            std::vector<int> scores;
+            while (queue.Pop(batch, options.batch_size)) {
+                boards.clear();
+                for (const auto& request : batch) {
+                    boards.push_back(request.board);
+                }
+                scores.resize(batch.size());
+                NNUE::EvaluateBatch(boards.data(), boards.size(), scores.data());
+
+                auto now = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < batch.size(); i++) {
+                    BackPropagate(tree, batch[i].path, ScoreToResult(scores[i]));
+                    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - batch[i].enqueue_time);
+                    AddToHistogram(latency_histogram, latency.count());
+                }
+                AddToHistogram(batch_size_histogram, batch.size());
+                pending_leaves -= batch.size();
+            }
+        };
+
+        std::thread evaluator_thread;
+        if (is_batched)
+            evaluator_thread = std::thread(evaluator);
+
+        std::vector<std::thread> helpers;
+        for (int i = 1; i < options.threads; i++) {
+            helpers.emplace_back(worker, false);
+        }
+        worker(true);
+        for (auto& helper : helpers) {
+            helper.join();
+        }
+
+        if (is_batched) {
+            queue.Close();
+            evaluator_thread.join();
         }
-        return best_move;
+
+        Stats result;
+        FillStats(result);
+        if (stats) {
+            *stats = result;
+            stats->iterations = iterations > 0 ? std::min(samples.load(), iterations) : samples.load();
+            stats->time_ms = elapsed_ms();
+            stats->batch_size_histogram = batch_size_histogram;
+            stats->latency_histogram = latency_histogram;
+        }
+        return result.best_line.empty() ? Move() : result.best_line.front();
+    }
+
+    Move Search(const Board& state, int iterations, const Options& options, Stats* stats){
+        Searcher searcher(options);
+        Limits limits;
+        limits.iterations = iterations;
+        return searcher.Search(state, limits, stats);
     }
-}
\ No newline at end of file
+}
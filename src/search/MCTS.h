@@ -1,11 +1,108 @@
 #ifndef MCTS_H
 #define MCTS_H
 
+// Default memory cap of the tree.
+#define MCTS_TREE_MB 256
+// Iterations of a search without limits.
+#define MCTS_DEFAULT_ITERATIONS 100000
+// Centipawns of the logistic mapping from scores to win probabilities.
+#define MCTS_SCORE_SCALE 400.0f
+// Interval of the progress reports of a search.
+#define MCTS_INFO_INTERVAL_MS 1000
+
+#include <array>
+#include <functional>
+#include <memory>
+
 #include <representation/Board.h>
+#include <search/Playout.h>
 #include <search/Search.h>
 
 namespace ChessEngine::MCTS{
-    Move Search(const Board& state, int iterations, bool for_white);
+    // How the value of a new leaf is estimated. Scores are mapped to a win probability.
+    enum class LeafEvaluation{
+        Rollout, // Random moves until the end of the game (see Playout::RandomGame).
+        Evaluate, // NNUE static evaluation.
+        QSearch, // Captures search with the NNUE at its leaves.
+        Playout // A few random moves (see Playout::RandomMoves) then the NNUE static evaluation.
+    };
+
+    // Game theoretic value of a position for its side to move, known from the proven values of its moves.
+    enum class Proof : uint8_t{
+        None, Win, Loss, Draw
+    };
+
+    struct Options{
+        int threads = 1; // Threads sampling the same tree.
+        int tree_mb = MCTS_TREE_MB; // The tree is kept in an arena of at most this size.
+        LeafEvaluation leaf_evaluation = LeafEvaluation::QSearch;
+        int playout_plies = 8; // Length of the Playout leaf evaluation.
+        int rollout_plies = PLAYOUT_MAX_PLIES; // Rollouts are adjudicated on material after this many plies.
+        // With a batch size the sampling threads queue their leaves and an evaluator thread values them
+        // in batches with the NNUE static evaluation, whatever the leaf evaluation.
+        int batch_size = 0;
+        int queue_depth = 256; // Sampling threads wait while this many leaves are queued.
+        // Size of a table of statistics shared by the nodes of the same position, so transpositions pool their
+        // visits and results. Disabled at 0.
+        int shared_mb = 0;
+    };
+
+    // Names: rollout, eval, qsearch, playout.
+    bool ParseLeafEvaluation(const std::string& name, LeafEvaluation& leaf_evaluation);
+
+    // Zero for no limit. Without any limit a search stops after MCTS_DEFAULT_ITERATIONS.
+    struct Limits{
+        int iterations = 0;
+        int time_ms = 0;
+    };
+
+    struct Stats{
+        int iterations = 0; // Samples of this search, the visits of a reused subtree are not counted.
+        int time_ms = 0;
+        float value = 0; // Expected result of the best move between -1 and 1.
+        std::vector<Move> best_line; // Following the most visited children , proven wins first.
+        Proof proof = Proof::None; // Of the root. A proven root ends the search.
+        size_t tree_nodes = 0; // Nodes in the arena.
+        int recycles = 0; // Times rarely visited subtrees were freed to make room.
+        size_t shared_entries = 0; // Positions in the shared statistics table.
+        uint64_t shared_hits = 0; // Nodes that found their position already in the table.
+        // Batched evaluation only. Bucket i counts the batches of [2^i , 2^(i+1)) leaves and the
+        // leaves that waited [2^i , 2^(i+1)) microseconds from being queued to being back propagated.
+        std::array<uint64_t, 32> batch_size_histogram = {};
+        std::array<uint64_t, 32> latency_histogram = {};
+    };
+
+    class Tree;
+
+    // Keeps the tree between searches. When a position follows the previous root by up to two moves
+    // (ours and the reply) the subtree of that position is kept.
+    class Searcher{
+    public:
+        explicit Searcher(const Options& options = {});
+        ~Searcher();
+
+        // The tree is cleared if its size or the size of its shared statistics changes.
+        void SetOptions(const Options& options);
+        const Options& GetOptions() const { return options_; }
+        void Clear();
+
+        // Returns the most visited move , a null move if the game is over. [on_info] is called every
+        // MCTS_INFO_INTERVAL_MS with the progress so far.
+        Move Search(const Board& state, const Limits& limits, Stats* stats = nullptr,
+                    const std::function<void(const Stats&)>& on_info = {});
+
+    private:
+        // Moves the root to [state] if it is in the tree. Returns false if it is not.
+        bool Reroot(const Board& state);
+        void FillStats(Stats& stats) const;
+
+        Options options_;
+        std::unique_ptr<Tree> tree_;
+        Board root_; // Position of the tree's root.
+    };
+
+    // Samples [iterations] times from [state] with a new tree and returns the most visited move.
+    Move Search(const Board& state, int iterations, const Options& options = {}, Stats* stats = nullptr);
 }
 
 #endif
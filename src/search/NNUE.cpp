@@ -1,9 +1,154 @@
 #include "NNUE.h"
 
+#include <algorithm>
 #include <cstring>
 
+#include <miscellaneous/Cpu.h>
+
 namespace ChessEngine{
 
+    namespace {
+        // The whole HalfKP model is evaluated by the engine. The accumulators are updated
+        // incrementally and the remaining layers run on top of them.
+        constexpr int piece_to_index[2][13] = {
+                {0, 0, 8 * 64 + 1, 6 * 64 + 1, 4 * 64 + 1, 2 * 64 + 1, 1,
+                 0, 9 * 64 + 1, 7 * 64 + 1, 5 * 64 + 1, 3 * 64 + 1, 1 * 64 + 1},
+                {0, 0, 9 * 64 + 1, 7 * 64 + 1, 5 * 64 + 1, 3 * 64 + 1, 1 * 64 + 1,
+                 0, 8 * 64 + 1, 6 * 64 + 1, 4 * 64 + 1, 2 * 64 + 1, 1}
+        };
+        constexpr int hidden_shift = 6;
+        constexpr int output_scale = 16;
+        constexpr int batch_size = 32;
+
+        using Accumulation = int16_t[2][FT_HALF_DIMENSIONS];
+
+        NNUEWeights::Network network;
+
+        int Orient(int perspective, int square){
+            return square ^ (perspective == White ? 0x00 : 0x3f);
+        }
+
+        int FeatureIndex(int perspective, int square, int piece, int oriented_king){
+            return Orient(perspective, square) + piece_to_index[perspective][piece] + NNUEWeights::ps_end * oriented_king;
+        }
+
+        // The same kernels are compiled for every instruction set.
+        template<bool add>
+        FORCE_INLINE void ApplyColumn(int16_t* accumulation, const int16_t* column){
+            for (int i = 0; i < FT_HALF_DIMENSIONS; i++)
+                accumulation[i] = add ? accumulation[i] + column[i] : accumulation[i] - column[i];
+        }
+
+        // Layers run on batches of positions. Inputs and outputs are stored position after position
+        // and each row of weights is reused for the whole batch while it is in cache.
+        template<int inputs>
+        FORCE_INLINE void AffineClipped(const uint8_t* input, uint8_t* output, int count, const int32_t* biases, const int8_t* weights){
+            for (int i = 0; i < HIDDEN_DIMENSIONS; i++) {
+                const int8_t* row = &weights[i * inputs];
+                for (int b = 0; b < count; b++) {
+                    int32_t sum = biases[i];
+                    for (int j = 0; j < inputs; j++)
+                        sum += row[j] * input[b * inputs + j];
+                    output[b * HIDDEN_DIMENSIONS + i] = std::clamp(sum >> hidden_shift, 0, 127);
+                }
+            }
+        }
+
+        FORCE_INLINE void ForwardLayers(const Accumulation* accumulations, const int* sides, int count, int* scores){
+            alignas(64) uint8_t input[batch_size][2 * FT_HALF_DIMENSIONS];
+            alignas(64) uint8_t hidden1[batch_size][HIDDEN_DIMENSIONS];
+            alignas(64) uint8_t hidden2[batch_size][HIDDEN_DIMENSIONS];
+
+            // Side to move first.
+            for (int b = 0; b < count; b++) {
+                const int perspectives[2] = {sides[b], !sides[b]};
+                for (int p = 0; p < 2; p++) {
+                    for (int i = 0; i < FT_HALF_DIMENSIONS; i++)
+                        input[b][p * FT_HALF_DIMENSIONS + i] = std::clamp<int>(accumulations[b][perspectives[p]][i], 0, 127);
+                }
+            }
+
+            AffineClipped<2 * FT_HALF_DIMENSIONS>(input[0], hidden1[0], count, network.hidden1_biases, network.hidden1_weights);
+            AffineClipped<HIDDEN_DIMENSIONS>(hidden1[0], hidden2[0], count, network.hidden2_biases, network.hidden2_weights);
+
+            for (int b = 0; b < count; b++) {
+                int32_t output = network.output_bias[0];
+                for (int i = 0; i < HIDDEN_DIMENSIONS; i++)
+                    output += network.output_weights[i] * hidden2[b][i];
+                scores[b] = output / output_scale;
+            }
+        }
+
+        using ColumnKernel = void (*)(int16_t* accumulation, const int16_t* column);
+        using PropagateKernel = void (*)(const Accumulation* accumulations, const int* sides, int count, int* scores);
+
+        struct Kernels{
+            ColumnKernel add_column;
+            ColumnKernel sub_column;
+            PropagateKernel propagate;
+        };
+
+        #define DEFINE_KERNELS(name, isa) \
+            TARGET_ISA(isa) void AddColumn##name(int16_t* accumulation, const int16_t* column) { ApplyColumn<true>(accumulation, column); } \
+            TARGET_ISA(isa) void SubColumn##name(int16_t* accumulation, const int16_t* column) { ApplyColumn<false>(accumulation, column); } \
+            TARGET_ISA(isa) void Propagate##name(const Accumulation* accumulations, const int* sides, int count, int* scores) { \
+                ForwardLayers(accumulations, sides, count, scores); \
+            } \
+            constexpr Kernels kernels##name = {AddColumn##name, SubColumn##name, Propagate##name};
+
+        DEFINE_KERNELS(Default, "default")
+    #ifdef CPU_DISPATCH
+        DEFINE_KERNELS(SSE2, "sse2")
+        DEFINE_KERNELS(SSE41, "sse4.1")
+        DEFINE_KERNELS(AVX2, "avx2")
+        DEFINE_KERNELS(AVX512, "avx512bw")
+        DEFINE_KERNELS(AVX512VNNI, "avx512bw,avx512vnni")
+    #endif
+
+        Kernels kernels = kernelsDefault;
+
+        void SelectKernels(){
+        #ifdef CPU_DISPATCH
+            switch (Cpu::GetSimdLevel()) {
+                case Cpu::SimdLevel::Default:
+                    break;
+                case Cpu::SimdLevel::SSE2:
+                    kernels = kernelsSSE2;
+                    break;
+                case Cpu::SimdLevel::SSE41:
+                    kernels = kernelsSSE41;
+                    break;
+                case Cpu::SimdLevel::AVX2:
+                    kernels = kernelsAVX2;
+                    break;
+                case Cpu::SimdLevel::AVX512:
+                    kernels = Cpu::HasVNNI() ? kernelsAVX512VNNI : kernelsAVX512;
+                    break;
+            }
+        #endif
+        }
+
+        void AddFeature(int16_t* accumulation, int feature){
+            kernels.add_column(accumulation, &network.ft_weights[feature * FT_HALF_DIMENSIONS]);
+        }
+
+        void SubFeature(int16_t* accumulation, int feature){
+            kernels.sub_column(accumulation, &network.ft_weights[feature * FT_HALF_DIMENSIONS]);
+        }
+
+        bool IsKing(int piece){
+            return piece == NNUE::GetPieceEncoding(King, White) || piece == NNUE::GetPieceEncoding(King, Black);
+        }
+
+        // Full computation of one perspective from the piece list.
+        void FillAccumulator(const Board::PieceList& piece_list, int perspective, int16_t* accumulation){
+            int oriented_king = Orient(perspective, piece_list.squares[perspective]);
+            std::memcpy(accumulation, network.ft_biases, sizeof(int16_t) * FT_HALF_DIMENSIONS);
+            for(int i = 2; i < piece_list.size; i++)
+                AddFeature(accumulation, FeatureIndex(perspective, piece_list.squares[i], piece_list.pieces[i], oriented_king));
+        }
+    }
+
     int NNUE::GetSideEncoding(const Team& team){
         return team == Team::White ? 0 : 1;
     }
@@ -69,93 +214,186 @@ namespace ChessEngine{
         return tile.GetIndex();
     }
 
-    void InitInput(Board::Representation representation, bool is_flipped, int* pieces, int* squares){
-        // index 0 -> white king.
-        // index 1 -> black king.
-        // index x -> piece encoding
-        // index n + 1 -> 0 for end of array.
-        // Ordering does not matter other than the kings.
+    int NNUE::Evaluate(const Board& board){
+        int score;
+        EvaluateBatch(&board, 1, &score);
+        return score;
+    }
 
-        // Make it so own is always white.
-        // Also mirrors the tiles.
-        if(is_flipped)
-            representation.Mirror();
-
-        int index = 0;
-        auto update_arrays = [&] (Bitboard piece_board, PieceType type) {
-            // White first for kings to work.
-            for(auto tile : piece_board & representation.own_pieces){
-                squares[index] = NNUE::GetSquareEncoding(tile);
-                pieces[index++] = NNUE::GetPieceEncoding(type, White);
-            }
-            for(auto tile : piece_board & representation.enemy_pieces){
-                squares[index] = NNUE::GetSquareEncoding(tile);
-                pieces[index++] = NNUE::GetPieceEncoding(type, Black);
+    void NNUE::EvaluateBatch(const Board* boards, int count, int* scores, int threads){
+        auto evaluate_range = [=](int begin, int end){
+            alignas(64) Accumulation accumulations[batch_size];
+            int sides[batch_size];
+            for(int batch_begin = begin; batch_begin < end; batch_begin += batch_size){
+                int size = std::min(batch_size, end - batch_begin);
+                for(int i = 0; i < size; i++){
+                    const Board& board = boards[batch_begin + i];
+                    FillAccumulator(board.GetPieceList(), White, accumulations[i][White]);
+                    FillAccumulator(board.GetPieceList(), Black, accumulations[i][Black]);
+                    sides[i] = NNUE::GetSideEncoding(board.IsFlipped());
+                }
+                kernels.propagate(accumulations, sides, size, &scores[batch_begin]);
             }
         };
 
-        update_arrays(representation.Kings(), King);
-        update_arrays(representation.Pawns(), Pawn);
-        update_arrays(representation.Knights(), Knight);
-        update_arrays(representation.Queens(), Queen);
-        update_arrays(representation.Rooks(), Rook);
-        update_arrays(representation.Bishops(), Bishop);
+        ParallelFor(count, threads, evaluate_range);
+    }
+
+    int NNUE::EvaluateIncremental(const Board& board){
+        // No move was played so there is no accumulator for this position.
+        int current_ply = board.GetPlyCounter() - 1;
+        if(current_ply < 0)
+            return Evaluate(board);
+
+        current_ply = AccumulatorPly(current_ply);
+        Accumulator& accumulator = nnue_data_arr[Slot(current_ply)].accumulator;
+        if(!accumulator.computedAccumulation)
+            ComputeAccumulator(board, current_ply);
 
-        pieces[index] = 0;
+        int side = NNUE::GetSideEncoding(board.IsFlipped());
+        int score;
+        kernels.propagate(&accumulator.accumulation, &side, 1, &score);
+        return score;
     }
 
-    int NNUE::Evaluate(const Board& board){
-        const int max_pieces = 16 * 2;
-        static int pieces[max_pieces + 1];
-        static int squares[max_pieces];
+    int NNUE::AccumulatorPly(int ply) const {
+        // Null moves share the accumulator of their parent.
+        while(ply > 0 && nnue_data_arr[Slot(ply)].dirtyPiece.dirtyNum == 0)
+            ply--;
+        return ply;
+    }
 
-        Board::Representation representation = board.GetRepresentation();
-        bool is_flipped = board.IsFlipped();
+    void NNUE::ComputeAccumulator(const Board& board, int ply){
+        // Walks back to the closest computed accumulator as long as applying the dirty pieces
+        // forward costs less than refreshing. A refresh adds at most every non king piece.
+        int refresh_cost = board.GetPieceList().size - 2;
+        int update_cost = 0;
+        int previous_ply = -1;
+        for(int i = ply; i > 0 && update_cost <= refresh_cost; i--){
+            const DirtyPiece& dirty_piece = nnue_data_arr[Slot(i)].dirtyPiece;
+            for(int j = 0; j < dirty_piece.dirtyNum; j++)
+                update_cost += (dirty_piece.from[j] != REMOVED_SQUARE) + (dirty_piece.to[j] != REMOVED_SQUARE);
 
-        InitInput(representation, is_flipped, pieces, squares);
-        int side = NNUE::GetSideEncoding(is_flipped);
-        int eval = nnue_evaluate(side, pieces, squares);
+            if(update_cost <= refresh_cost && nnue_data_arr[Slot(i - 1)].accumulator.computedAccumulation){
+                previous_ply = i - 1;
+                break;
+            }
+        }
+
+        Accumulator& accumulator = nnue_data_arr[Slot(ply)].accumulator;
+        for(int perspective = White; perspective <= Black; perspective++){
+            // A king move changes every feature of its own perspective.
+            int king = GetPieceEncoding(King, Team(perspective));
+            bool king_moved = previous_ply < 0;
+            for(int i = previous_ply + 1; i <= ply && !king_moved; i++){
+                const DirtyPiece& dirty_piece = nnue_data_arr[Slot(i)].dirtyPiece;
+                for(int j = 0; j < dirty_piece.dirtyNum; j++)
+                    king_moved |= dirty_piece.pc[j] == king;
+            }
 
-        return eval;
+            if(king_moved)
+                RefreshAccumulator(board, perspective, accumulator.accumulation[perspective]);
+            else
+                UpdateAccumulator(board, perspective, previous_ply, ply);
+        }
+        accumulator.computedAccumulation = 1;
     }
 
-    int NNUE::EvaluateIncremental(const Board& board){
-        const int max_pieces = 16 * 2;
-        static int pieces[max_pieces + 1];
-        static int squares[max_pieces];
+    void NNUE::RefreshAccumulator(const Board& board, int perspective, int16_t* accumulation){
+        const Board::PieceList& piece_list = board.GetPieceList();
+        int king_square = piece_list.squares[perspective];
+        int oriented_king = Orient(perspective, king_square);
+        RefreshEntry& entry = refresh_table[perspective * 64 + king_square];
 
-        Board::Representation representation = board.GetRepresentation();
-        bool is_flipped = board.IsFlipped();
+        // Kings are not features.
+        Bitboard piece_boards[13] = {};
+        for(int i = 2; i < piece_list.size; i++)
+            piece_boards[piece_list.pieces[i]].Set(piece_list.squares[i]);
 
-        // TODO: nnue prob does not need this for most of the calls...
-        InitInput(representation, is_flipped, pieces, squares);
-        int side = NNUE::GetSideEncoding(is_flipped);
+        for(int piece = 0; piece < 13; piece++){
+            for(auto tile : entry.piece_boards[piece] - piece_boards[piece])
+                SubFeature(entry.accumulation, FeatureIndex(perspective, tile.GetIndex(), piece, oriented_king));
+            for(auto tile : piece_boards[piece] - entry.piece_boards[piece])
+                AddFeature(entry.accumulation, FeatureIndex(perspective, tile.GetIndex(), piece, oriented_king));
+            entry.piece_boards[piece] = piece_boards[piece];
+        }
+
+        memcpy(accumulation, entry.accumulation, sizeof(entry.accumulation));
+    }
 
-        uint8_t current_ply = board.GetPlyCounter() - 1;
-        NNUEdata* nnue_latest_data[3] = {0, 0, 0};
-        for(int i = 0; i < 3 && current_ply >= i; i++)
-            nnue_latest_data[i] = &nnue_data_arr[current_ply - i];
+    void NNUE::UpdateAccumulator(const Board& board, int perspective, int from_ply, int to_ply){
+        int oriented_king = Orient(perspective, board.GetPieceList().squares[perspective]);
+        int16_t* accumulation = nnue_data_arr[Slot(to_ply)].accumulator.accumulation[perspective];
+        memcpy(accumulation, nnue_data_arr[Slot(from_ply)].accumulator.accumulation[perspective],
+               sizeof(int16_t) * FT_HALF_DIMENSIONS);
 
-        return nnue_evaluate_incremental(side, pieces, squares, &nnue_latest_data[0]);
+        for(int i = from_ply + 1; i <= to_ply; i++){
+            const DirtyPiece& dirty_piece = nnue_data_arr[Slot(i)].dirtyPiece;
+            for(int j = 0; j < dirty_piece.dirtyNum; j++){
+                int piece = dirty_piece.pc[j];
+                if(IsKing(piece))
+                    continue;
+                if(dirty_piece.from[j] != REMOVED_SQUARE)
+                    SubFeature(accumulation, FeatureIndex(perspective, dirty_piece.from[j], piece, oriented_king));
+                if(dirty_piece.to[j] != REMOVED_SQUARE)
+                    AddFeature(accumulation, FeatureIndex(perspective, dirty_piece.to[j], piece, oriented_king));
+            }
+        }
+    }
+
+    void NNUE::ClearRefreshTable(){
+        // An empty board has only the biases.
+        for(int i = 0; i < 2 * 64; i++){
+            memcpy(refresh_table[i].accumulation, network.ft_biases, sizeof(int16_t) * FT_HALF_DIMENSIONS);
+            for(auto& piece_board : refresh_table[i].piece_boards)
+                piece_board = Bitboard(0);
+        }
+    }
+
+    void NNUE::ResetAccumulator(const Board& board){
+        // Evaluated from scratch anyway.
+        int ply = board.GetPlyCounter() - 1;
+        if(ply < 0)
+            return;
+
+        NNUEdata& data = nnue_data_arr[Slot(ply)];
+        for(int perspective = White; perspective <= Black; perspective++)
+            RefreshAccumulator(board, perspective, data.accumulator.accumulation[perspective]);
+        data.accumulator.computedAccumulation = 1;
+
+        // Not a null move , AccumulatorPly stops here. No update walks through it since it is computed.
+        data.dirtyPiece.dirtyNum = 1;
+        data.dirtyPiece.pc[0] = 0;
+        data.dirtyPiece.from[0] = REMOVED_SQUARE;
+        data.dirtyPiece.to[0] = REMOVED_SQUARE;
     }
 
     void NNUE::InitAccumulator(int ply){
-        nnue_data_arr[ply].accumulator.computedAccumulation = 0;
+        nnue_data_arr[Slot(ply)].accumulator.computedAccumulation = 0;
     }
 
     DirtyPiece* NNUE::GetDirtyPiece(int ply){
-        return &(nnue_data_arr[ply].dirtyPiece);
+        return &(nnue_data_arr[Slot(ply)].dirtyPiece);
     }
 
-    void NNUE::CopyToNextAccumulator(int ply){
-        assert(ply - 1 >= 0);
-        memcpy(&nnue_data_arr[ply].accumulator, &nnue_data_arr[ply - 1].accumulator, sizeof(Accumulator));
-        DirtyPiece* dp = &(nnue_data_arr[ply].dirtyPiece);
-        dp->dirtyNum = 0;
+    void NNUE::InitNullMoveAccumulator(int ply){
+        // No pieces change so the position keeps using the accumulator of its parent.
+        nnue_data_arr[Slot(ply)].accumulator.computedAccumulation = 0;
+        nnue_data_arr[Slot(ply)].dirtyPiece.dirtyNum = 0;
     }
 
     void NNUE::InitModel(char* file_name){
-        nnue_init(file_name);
+        SelectKernels();
+
+        bool is_mapped;
+        if(!NNUEWeights::Load(file_name, network, is_mapped)){
+            std::cout << "[ERROR] Could not load the NNUE model " << file_name << std::endl;
+            exit(ERROR);
+        }
+        if(!is_mapped)
+            std::cout << "info string NNUE weights could not be memory mapped, using private memory" << std::endl;
+
+        Instance().ClearRefreshTable();
     }
 
 }
\ No newline at end of file
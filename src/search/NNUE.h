@@ -2,30 +2,38 @@
 #define NNUE_WRAPPER_H
 
 #define REMOVED_SQUARE 64 // TODO: better way?
-#define MAX_HSTACK 1024 // Max size of NNUE alligned memory.
+#define MAX_HSTACK 1024 // Max size of NNUE alligned memory. Power of 2 , indexed by ply modulo its size.
 
 #include <miscellaneous/Utilities.h>
 #include <representation/Board.h>
+#include <search/NNUEWeights.h>
 #include <nnue-probe/src/nnue.h>
 
 namespace ChessEngine {
+    // Every thread has its own accumulators so searches can run in parallel, the weights are shared.
     class NNUE{
     public:
         static NNUE& Instance() {
-            static NNUE instance;
+            static thread_local NNUE instance;
             return instance;
         }
 
         static void InitModel(char* file_name);
 
         static int Evaluate(const Board& board);
+        // Scores of unrelated positions, computed in batches and split across [threads].
+        static void EvaluateBatch(const Board* boards, int count, int* scores, int threads = 1);
         int EvaluateIncremental(const Board& board);
 
         void InitAccumulator(int ply);
-        void CopyToNextAccumulator(int ply);
+        // Accumulators of earlier plies can belong to other positions (other games or searches). Computes the
+        // one of [board] from scratch so the evaluations of the following plies never walk back past it.
+        void ResetAccumulator(const Board& board);
+        void InitNullMoveAccumulator(int ply);
         DirtyPiece* GetDirtyPiece(int ply);
+        void ClearRefreshTable();
 
-        // Converts engine's types to the required input of the NNUE probe lib.
+        // Converts engine's types to the input encoding of the NNUE probe lib.
         static int GetSideEncoding(const Team& team);
         static int GetSideEncoding(bool is_flipped);
         static int GetPieceEncoding(const PieceType& type, const Team& team);
@@ -35,8 +43,32 @@ namespace ChessEngine {
         static int GetSquareEncoding(BoardTile tile, bool is_flipped);
 
     private:
-        NNUE() { AlignedReserve<NNUEdata>(nnue_data_arr, MAX_HSTACK); }
+        // Last accumulator computed for a king square and perspective ("finny tables").
+        // A refresh only applies the difference between the stored and the current pieces.
+        struct RefreshEntry{
+            alignas(64) int16_t accumulation[FT_HALF_DIMENSIONS];
+            Bitboard piece_boards[13]; // Indexed by piece encoding.
+        };
+
+        NNUE() {
+            AlignedReserve<NNUEdata>(nnue_data_arr, MAX_HSTACK);
+            AlignedReserve<RefreshEntry>(refresh_table, 2 * 64);
+            ClearRefreshTable();
+        }
+        ~NNUE() {
+            AlignedFree(nnue_data_arr);
+            AlignedFree(refresh_table);
+        }
+
+        // Accumulators are a ring buffer over the plies of the game, updates only look a few plies back.
+        static int Slot(int ply) { return ply & (MAX_HSTACK - 1); }
+        int AccumulatorPly(int ply) const;
+        void ComputeAccumulator(const Board& board, int ply);
+        void RefreshAccumulator(const Board& board, int perspective, int16_t* accumulation);
+        void UpdateAccumulator(const Board& board, int perspective, int from_ply, int to_ply);
+
         NNUEdata* nnue_data_arr;
+        RefreshEntry* refresh_table; // [perspective][king square]
     };
 
 }
@@ -0,0 +1,209 @@
+#include "NNUEWeights.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <miscellaneous/Utilities.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ChessEngine::NNUEWeights {
+
+    namespace {
+        constexpr uint32_t nnue_version = 0x7AF32F16;
+        constexpr char blob_magic[8] = "NNUEBLB";
+        constexpr uint32_t blob_version = 1;
+
+        // The source's size and modification time tell if the blob is stale.
+        struct BlobHeader{
+            char magic[8];
+            uint32_t version;
+            uint64_t source_size;
+            int64_t source_time;
+        };
+
+        constexpr size_t Align(size_t offset){
+            return (offset + CACHE_LINE_SIZE - 1) & ~size_t(CACHE_LINE_SIZE - 1);
+        }
+
+        // Offsets of each section inside the blob. Every section starts on a cache line.
+        struct Layout{
+            size_t ft_biases, ft_weights;
+            size_t hidden1_biases, hidden1_weights;
+            size_t hidden2_biases, hidden2_weights;
+            size_t output_bias, output_weights;
+            size_t size;
+        };
+
+        constexpr Layout MakeLayout(){
+            Layout layout{};
+            layout.ft_biases = Align(sizeof(BlobHeader));
+            layout.ft_weights = Align(layout.ft_biases + sizeof(int16_t) * FT_HALF_DIMENSIONS);
+            layout.hidden1_biases = Align(layout.ft_weights + sizeof(int16_t) * FT_HALF_DIMENSIONS * ft_inputs);
+            layout.hidden1_weights = Align(layout.hidden1_biases + sizeof(int32_t) * HIDDEN_DIMENSIONS);
+            layout.hidden2_biases = Align(layout.hidden1_weights + HIDDEN_DIMENSIONS * 2 * FT_HALF_DIMENSIONS);
+            layout.hidden2_weights = Align(layout.hidden2_biases + sizeof(int32_t) * HIDDEN_DIMENSIONS);
+            layout.output_bias = Align(layout.hidden2_weights + HIDDEN_DIMENSIONS * HIDDEN_DIMENSIONS);
+            layout.output_weights = Align(layout.output_bias + sizeof(int32_t));
+            layout.size = Align(layout.output_weights + HIDDEN_DIMENSIONS);
+            return layout;
+        }
+
+        constexpr Layout layout = MakeLayout();
+
+        void SetPointers(const char* blob, Network& network){
+            network.ft_biases = reinterpret_cast<const int16_t*>(blob + layout.ft_biases);
+            network.ft_weights = reinterpret_cast<const int16_t*>(blob + layout.ft_weights);
+            network.hidden1_biases = reinterpret_cast<const int32_t*>(blob + layout.hidden1_biases);
+            network.hidden1_weights = reinterpret_cast<const int8_t*>(blob + layout.hidden1_weights);
+            network.hidden2_biases = reinterpret_cast<const int32_t*>(blob + layout.hidden2_biases);
+            network.hidden2_weights = reinterpret_cast<const int8_t*>(blob + layout.hidden2_weights);
+            network.output_bias = reinterpret_cast<const int32_t*>(blob + layout.output_bias);
+            network.output_weights = reinterpret_cast<const int8_t*>(blob + layout.output_weights);
+        }
+
+        bool GetSourceInfo(const char* file_name, BlobHeader& header){
+            std::memcpy(header.magic, blob_magic, sizeof(blob_magic));
+            header.version = blob_version;
+        #ifndef _WIN32
+            struct stat info{};
+            if(stat(file_name, &info) != 0)
+                return false;
+            header.source_size = info.st_size;
+            header.source_time = info.st_mtime;
+        #else
+            std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+            if(!file)
+                return false;
+            header.source_size = file.tellg();
+            header.source_time = 0;
+        #endif
+            return true;
+        }
+
+        // Reads the sections of the .nnue file into their place inside the blob.
+        bool Convert(const char* file_name, BlobHeader& header, char* blob){
+            std::ifstream file(file_name, std::ios::binary);
+            if(!file)
+                return false;
+
+            auto read = [&](size_t offset, size_t size) { file.read(blob + offset, size); };
+            auto skip = [&](size_t size) { file.seekg(size, std::ios::cur); };
+
+            // Header : version, hash, description size and description.
+            // The transformer and network sections start with their own hashes.
+            uint32_t file_header[3];
+            file.read(reinterpret_cast<char*>(file_header), sizeof(file_header));
+            if(!file || file_header[0] != nnue_version)
+                return false;
+            skip(file_header[2]);
+
+            skip(sizeof(uint32_t));
+            read(layout.ft_biases, sizeof(int16_t) * FT_HALF_DIMENSIONS);
+            read(layout.ft_weights, sizeof(int16_t) * FT_HALF_DIMENSIONS * ft_inputs);
+
+            skip(sizeof(uint32_t));
+            read(layout.hidden1_biases, sizeof(int32_t) * HIDDEN_DIMENSIONS);
+            read(layout.hidden1_weights, HIDDEN_DIMENSIONS * 2 * FT_HALF_DIMENSIONS);
+            read(layout.hidden2_biases, sizeof(int32_t) * HIDDEN_DIMENSIONS);
+            read(layout.hidden2_weights, HIDDEN_DIMENSIONS * HIDDEN_DIMENSIONS);
+            read(layout.output_bias, sizeof(int32_t));
+            read(layout.output_weights, HIDDEN_DIMENSIONS);
+            if(!file)
+                return false;
+
+            std::memcpy(blob, &header, sizeof(header));
+            return true;
+        }
+
+    #ifndef _WIN32
+        bool WriteBlob(const std::string& blob_name, const char* blob){
+            // Written under a temporary name and renamed so concurrently starting
+            // processes never map a half written blob.
+            std::string temp_name = blob_name + ".tmp" + std::to_string(getpid());
+            {
+                std::ofstream file(temp_name, std::ios::binary);
+                file.write(blob, layout.size);
+                if(!file) {
+                    std::remove(temp_name.c_str());
+                    return false;
+                }
+            }
+            return std::rename(temp_name.c_str(), blob_name.c_str()) == 0;
+        }
+
+        const char* MapBlob(const std::string& blob_name, const BlobHeader& source){
+            int fd = open(blob_name.c_str(), O_RDONLY);
+            if(fd < 0)
+                return nullptr;
+
+            struct stat info{};
+            void* mapping = MAP_FAILED;
+            if(fstat(fd, &info) == 0 && size_t(info.st_size) == layout.size)
+                mapping = mmap(nullptr, layout.size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(mapping == MAP_FAILED)
+                return nullptr;
+
+            auto header = static_cast<const BlobHeader*>(mapping);
+            bool is_valid = std::memcmp(header->magic, blob_magic, sizeof(blob_magic)) == 0 &&
+                    header->version == blob_version &&
+                    header->source_size == source.source_size &&
+                    header->source_time == source.source_time;
+            if(!is_valid){
+                munmap(mapping, layout.size);
+                return nullptr;
+            }
+
+            return static_cast<const char*>(mapping);
+        }
+    #else
+        bool WriteBlob(const std::string& blob_name, const char* blob) { return false; }
+        const char* MapBlob(const std::string& blob_name, const BlobHeader& source) { return nullptr; }
+    #endif
+    }
+
+    bool Load(const char* file_name, Network& network, bool& is_mapped){
+        BlobHeader header{};
+        if(!GetSourceInfo(file_name, header))
+            return false;
+
+        // Fast path , the blob was already converted by an earlier run.
+        std::string blob_name = std::string(file_name) + ".bin";
+        const char* mapped_blob = MapBlob(blob_name, header);
+        if(mapped_blob){
+            SetPointers(mapped_blob, network);
+            is_mapped = true;
+            return true;
+        }
+
+        char* blob;
+        AlignedReserve<char>(blob, layout.size);
+        if(!Convert(file_name, header, blob)){
+            AlignedFree(blob);
+            return false;
+        }
+
+        if(WriteBlob(blob_name, blob))
+            mapped_blob = MapBlob(blob_name, header);
+        if(mapped_blob){
+            AlignedFree(blob);
+            SetPointers(mapped_blob, network);
+            is_mapped = true;
+        }else{
+            // Kept for the whole run.
+            SetPointers(blob, network);
+            is_mapped = false;
+        }
+
+        return true;
+    }
+
+}
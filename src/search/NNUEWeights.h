@@ -0,0 +1,34 @@
+#ifndef NNUE_WEIGHTS_H
+#define NNUE_WEIGHTS_H
+
+#include <cstdint>
+
+#define FT_HALF_DIMENSIONS 256 // Size of one perspective of the accumulator.
+#define HIDDEN_DIMENSIONS 32 // Size of both hidden layers.
+
+namespace ChessEngine::NNUEWeights {
+
+    // HalfKP inputs : 64 king squares * (10 piece types * 64 squares + 1).
+    constexpr int ps_end = 10 * 64 + 1;
+    constexpr int ft_inputs = 64 * ps_end;
+
+    // Read only views of the HalfKP 256x2-32-32 weights.
+    struct Network{
+        const int16_t* ft_biases;
+        const int16_t* ft_weights; // [input][FT_HALF_DIMENSIONS]
+        const int32_t* hidden1_biases;
+        const int8_t* hidden1_weights; // [output][2 * FT_HALF_DIMENSIONS]
+        const int32_t* hidden2_biases;
+        const int8_t* hidden2_weights; // [output][HIDDEN_DIMENSIONS]
+        const int32_t* output_bias;
+        const int8_t* output_weights; // [HIDDEN_DIMENSIONS]
+    };
+
+    // The .nnue file is converted once into an aligned blob stored next to it ([file_name].bin).
+    // The blob is memory mapped read only so engine processes share the same physical pages.
+    // If the blob can not be written or mapped the converted weights are kept in private memory.
+    bool Load(const char* file_name, Network& network, bool& is_mapped);
+
+}
+
+#endif
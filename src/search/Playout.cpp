@@ -0,0 +1,246 @@
+#include "Playout.h"
+
+#include <cmath>
+#include <random>
+
+#include <moves/PseudoMoves.h>
+#include <representation/AttackTables.h>
+
+namespace ChessEngine::Playout {
+
+    namespace {
+
+        // The board state a random game needs, normalised to the side to move like Board.
+        struct State {
+            Board::Representation rep;
+            Board::CastlingRights rights;
+            int half_moves;
+        };
+
+        // xorshift64* , seeded once per thread.
+        uint64_t NextRandom() {
+            static thread_local uint64_t state = std::random_device{}() | 1ull << 32;
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        // Uniform in [0, bound) without a division.
+        uint32_t RandomIndex(size_t bound) {
+            return (uint32_t(NextRandom() >> 32) * uint64_t(bound)) >> 32;
+        }
+
+        // [all] and [enemy] may differ from the representation's by a move being tested.
+        bool IsAttacked(const Board::Representation& rep, BoardTile tile, Bitboard all, Bitboard enemy) {
+            uint8_t tile_index = tile.GetIndex();
+            return AttackTables::KingAttacks(tile_index).Get(rep.enemy_king)
+                || !(AttackTables::RookAttacks(tile_index, all) & enemy & rep.rook_queens).IsEmpty()
+                || !(AttackTables::BishopAttacks(tile_index, all) & enemy & rep.bishop_queens).IsEmpty()
+                || !(AttackTables::KnightAttacks(tile_index) & enemy & rep.Knights()).IsEmpty()
+                || !(AttackTables::PawnsAttacks(tile_index) & enemy & rep.pawns_enPassant).IsEmpty();
+        }
+
+        bool IsAttacked(const Board::Representation& rep, BoardTile tile) {
+            return IsAttacked(rep, tile, rep.own_pieces | rep.enemy_pieces, rep.enemy_pieces);
+        }
+
+        // Board::PlayMove without the bookkeeping. Does not alter the turn.
+        void PlayMove(State& state, Move move) {
+            Board::Representation& rep = state.rep;
+            BoardTile from = move.GetFrom();
+            BoardTile to = move.GetTo();
+            PieceType promotion = move.GetPromotion();
+            PieceType own_piece_type = move.GetMovedPiece();
+            Move::Flag flag = move.GetFlag();
+
+            bool reset_50_move_rule = move.IsCapture() || own_piece_type == Pawn;
+            rep.rook_queens.Reset(to);
+            rep.bishop_queens.Reset(to);
+            rep.pawns_enPassant.Reset(to);
+
+            if (own_piece_type == King) {
+                state.rights.ResetOwnKingSide();
+                state.rights.ResetOwnQueenSide();
+                if (flag == Move::Castling) {
+                    bool is_queen_side = to.GetFile() < from.GetFile();
+                    BoardTile rook_from = is_queen_side ? Masks::queen_rook : Masks::king_rook;
+                    BoardTile rook_to = is_queen_side ? Masks::queen_rook + 3 : Masks::king_rook - 2;
+                    rep.rook_queens.Reset(rook_from);
+                    rep.rook_queens.Set(rook_to);
+                    rep.own_pieces.Reset(rook_from);
+                    rep.own_pieces.Set(rook_to);
+                }
+                rep.own_king = to;
+            } else if (from == Masks::queen_rook) {
+                state.rights.ResetOwnQueenSide();
+            } else if (from == Masks::king_rook) {
+                state.rights.ResetOwnKingSide();
+            } else if (own_piece_type == Pawn) {
+                if (flag == Move::DoublePush) {
+                    rep.pawns_enPassant.Set(from.GetFile(), 0);
+                } else if (flag == Move::EnPassant) {
+                    BoardTile enemy_pawn = BoardTile(to.GetFile(), to.GetRank() - 1);
+                    rep.pawns_enPassant.Reset(enemy_pawn);
+                    rep.enemy_pieces.Reset(enemy_pawn);
+                } else if (promotion == Queen || promotion == Bishop) {
+                    rep.bishop_queens.Set(to);
+                }
+                if (promotion == Queen || promotion == Rook)
+                    rep.rook_queens.Set(to);
+            }
+
+            const uint8_t enemy_rooks_offset = 7 * 8;
+            if (to == Masks::queen_rook + enemy_rooks_offset)
+                state.rights.ResetEnemyQueenSide();
+            else if (to == Masks::king_rook + enemy_rooks_offset)
+                state.rights.ResetEnemyKingSide();
+            rep.pawns_enPassant -= Masks::rank_8;
+
+            rep.own_pieces.Reset(from);
+            rep.own_pieces.Set(to);
+            rep.enemy_pieces.Reset(to);
+            rep.rook_queens.SetIf(to, rep.rook_queens.Get(from));
+            rep.bishop_queens.SetIf(to, rep.bishop_queens.Get(from));
+            rep.pawns_enPassant.SetIf(to, rep.pawns_enPassant.Get(from) && promotion == None);
+            rep.rook_queens.Reset(from);
+            rep.bishop_queens.Reset(from);
+            rep.pawns_enPassant.Reset(from);
+
+            state.half_moves = reset_50_move_rule ? 0 : state.half_moves + 1;
+        }
+
+        // Tests the king against the occupancy after the move instead of playing it. The rook of a
+        // castling move can not block an attack on the king's tile.
+        bool IsLegal(const State& state, Move move, bool is_in_check) {
+            const Board::Representation& rep = state.rep;
+            BoardTile from = move.GetFrom();
+            BoardTile to = move.GetTo();
+            if (move.GetFlag() == Move::Castling) {
+                int direction = to.GetFile() < from.GetFile() ? -1 : 1;
+                if (is_in_check || IsAttacked(rep, from + direction))
+                    return false;
+            }
+
+            Bitboard enemy = rep.enemy_pieces - to;
+            Bitboard all = ((rep.own_pieces | rep.enemy_pieces) - from) | to;
+            if (move.GetFlag() == Move::EnPassant) {
+                BoardTile enemy_pawn = BoardTile(to.GetFile(), to.GetRank() - 1);
+                enemy = enemy - enemy_pawn;
+                all = all - enemy_pawn;
+            }
+            BoardTile king = move.GetMovedPiece() == King ? to : rep.own_king;
+            return !IsAttacked(rep, king, all, enemy);
+        }
+
+        bool IsInsufficientMaterial(const Board::Representation& rep) {
+            Bitboard all = rep.own_pieces | rep.enemy_pieces;
+            return rep.Pawns().IsEmpty() && rep.rook_queens.IsEmpty() && all.Count() <= 3;
+        }
+
+        void Mirror(State& state) {
+            state.rep.Mirror();
+            state.rights.Mirror();
+        }
+
+        uint64_t Perft(const State& state, int depth) {
+            MoveList moves;
+            PseudoMoves::Generate<GenType::All>(state.rep, state.rights, Bitboard(), moves);
+            bool is_in_check = IsAttacked(state.rep, state.rep.own_king);
+
+            uint64_t nodes = 0;
+            for (auto move : moves) {
+                if (!IsLegal(state, move, is_in_check))
+                    continue;
+                if (depth == 1) {
+                    nodes++;
+                    continue;
+                }
+                State next = state;
+                PlayMove(next, move);
+                Mirror(next);
+                nodes += Perft(next, depth - 1);
+            }
+            return nodes;
+        }
+
+        // Centipawns for the side to move.
+        int Material(const Board::Representation& rep) {
+            auto balance = [&](Bitboard pieces) {
+                return (pieces & rep.own_pieces).Count() - (pieces & rep.enemy_pieces).Count();
+            };
+            return 100 * balance(rep.Pawns()) + 300 * balance(rep.Knights()) + 300 * balance(rep.Bishops())
+                 + 500 * balance(rep.Rooks()) + 900 * balance(rep.Queens());
+        }
+
+        // Plays random moves on [state] until the game ends or [max_plies] are played, [ply] is set to the moves
+        // played. Returns true and the [result] for the side to move at the start if the game ended.
+        // The moves are appended to [played] if given.
+        bool RandomMoves(State& state, int max_plies, int& ply, float& result, MoveList* played) {
+            static thread_local MoveList moves;
+
+            float sign = 1;
+            for (ply = 0; ; ply++) {
+                if (state.half_moves >= 100 || IsInsufficientMaterial(state.rep)) {
+                    result = 0;
+                    return true;
+                }
+                if (ply == max_plies)
+                    return false;
+
+                moves.clear();
+                PseudoMoves::Generate<GenType::All>(state.rep, state.rights, Bitboard(), moves);
+                bool is_in_check = IsAttacked(state.rep, state.rep.own_king);
+
+                // Pseudo moves are drawn at random until one is legal , illegal ones are removed.
+                bool has_move = false;
+                while (!moves.empty()) {
+                    uint32_t index = RandomIndex(moves.size());
+                    if (IsLegal(state, moves[index], is_in_check)) {
+                        PlayMove(state, moves[index]);
+                        if (played)
+                            played->push_back(moves[index]);
+                        has_move = true;
+                        break;
+                    }
+                    moves[index] = moves.back();
+                    moves.pop_back();
+                }
+                if (!has_move) {
+                    // Mate or stalemate , only the side to move can lose.
+                    result = is_in_check ? -sign : 0;
+                    return true;
+                }
+
+                Mirror(state);
+                sign = -sign;
+            }
+        }
+    }
+
+    float RandomGame(const Board& board, int max_plies, int* plies) {
+        State state = {board.GetRepresentation(), board.GetCastlingRights(), board.GetHalfMoves()};
+        int ply;
+        float result;
+        if (!RandomMoves(state, max_plies, ply, result, nullptr)) {
+            // The state is seen from the side to move after [ply] moves.
+            float sign = ply % 2 ? -1 : 1;
+            result = sign * std::tanh(Material(state.rep) / PLAYOUT_ADJUDICATION_SCALE);
+        }
+
+        if (plies)
+            *plies = ply;
+        return result;
+    }
+
+    bool RandomMoves(const Board& board, int max_plies, MoveList& moves, float& result) {
+        State state = {board.GetRepresentation(), board.GetCastlingRights(), board.GetHalfMoves()};
+        int ply;
+        return RandomMoves(state, max_plies, ply, result, &moves);
+    }
+
+    uint64_t Perft(const Board& board, int depth) {
+        State state = {board.GetRepresentation(), board.GetCastlingRights(), board.GetHalfMoves()};
+        return depth > 0 ? Perft(state, depth) : 1;
+    }
+}
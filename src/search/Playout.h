@@ -0,0 +1,28 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+// Centipawns of the material balance that adjudicates an unfinished playout to a result of tanh(1).
+#define PLAYOUT_ADJUDICATION_SCALE 800.0f
+// Default length after which a playout is adjudicated.
+#define PLAYOUT_MAX_PLIES 300
+
+#include <representation/Board.h>
+
+namespace ChessEngine::Playout {
+    // Plays uniformly random legal moves from [board] until the game ends or [max_plies] are played, on a copy of
+    // the bitboards only: no NNUE, zobrist key, piece list or history updates. Legal moves are sampled by rejection
+    // from the pseudo moves. Repetitions are not detected, the 50 move rule and bare minor pieces are draws.
+    // Returns the result for the side to move of [board] , 1 won , 0 drawn , -1 lost. Unfinished games
+    // are adjudicated on material between -1 and 1.
+    // [plies] is set to the plies played.
+    float RandomGame(const Board& board, int max_plies = PLAYOUT_MAX_PLIES, int* plies = nullptr);
+
+    // The moves of RandomGame without the adjudication: at most [max_plies] are played and appended to [moves].
+    // Returns true and sets [result] , for the side to move of [board] , if the game ended within them.
+    bool RandomMoves(const Board& board, int max_plies, MoveList& moves, float& result);
+
+    // Leaf nodes at [depth] found by the playout move generation and legality test , must match the board's.
+    uint64_t Perft(const Board& board, int depth);
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "ProofNumber.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include <representation/History.h>
+
+// Proof and disproof numbers of a solved node.
+#define PN_INFINITY 100000000u
+
+namespace ChessEngine::ProofNumber {
+
+    namespace {
+
+        // Proof numbers are for the side that looks for the mate (attacker). Disproved also covers
+        // positions the attacker can not mate in the plies left.
+        struct Entry {
+            uint64_t key = 0;
+            uint32_t pn = 1;
+            uint32_t dn = 1;
+            uint16_t move = 0; // Compressed best move.
+            uint8_t depth = 0; // Plies left.
+        };
+
+        // Buckets of 2 entries keyed by zobrist key , the one with less plies left is replaced.
+        class Table {
+        public:
+            explicit Table(size_t bytes) : bucket_count_(std::max<size_t>(bytes / (2 * sizeof(Entry)), 1)),
+                                           entries_(new Entry[2 * bucket_count_]) {}
+
+            // A proof holds with more plies left and a disproof with less.
+            const Entry* Find(uint64_t key, int depth) const {
+                const Entry* bucket = &entries_[2 * (key % bucket_count_)];
+                for (int i = 0; i < 2; i++) {
+                    const Entry& entry = bucket[i];
+                    if (entry.key != key)
+                        continue;
+                    if (entry.depth == depth || (entry.pn == 0 && entry.depth <= depth) || (entry.dn == 0 && entry.depth >= depth))
+                        return &entry;
+                }
+                return nullptr;
+            }
+
+            void Store(uint64_t key, int depth, uint32_t pn, uint32_t dn, Move move) {
+                Entry* bucket = &entries_[2 * (key % bucket_count_)];
+                Entry* entry = bucket[0].key == key && bucket[0].depth == depth ? &bucket[0]
+                        : bucket[1].key == key && bucket[1].depth == depth ? &bucket[1]
+                        : bucket[0].depth < bucket[1].depth ? &bucket[0] : &bucket[1];
+                *entry = {key, pn, dn, move.Compress(), uint8_t(depth)};
+            }
+
+        private:
+            size_t bucket_count_;
+            std::unique_ptr<Entry[]> entries_;
+        };
+
+        uint32_t Add(uint32_t a, uint32_t b) {
+            return std::min(a + b, PN_INFINITY);
+        }
+
+        // The search works with phi and delta, the proof and disproof numbers of the side to move:
+        // (pn, dn) at attacker nodes and (dn, pn) at defender nodes. A node's phi is the smallest delta
+        // of its children and its delta the sum of their phis.
+        class Solver {
+        public:
+            Solver(uint64_t max_nodes) : table_(size_t(PN_TABLE_MB) * 1024 * 1024), max_nodes_(max_nodes) {}
+
+            // Plies left are odd at attacker nodes.
+            void MID(const Board& board, int depth, uint32_t th_phi, uint32_t th_delta, uint32_t& phi, uint32_t& delta) {
+                nodes_++;
+                bool is_attacker = depth % 2 == 1;
+                MoveList moves = board.GetLegalMoves();
+                GameResult result = board.Result(moves);
+                if (result != GameResult::Playing) {
+                    // A mated side to move lost, any draw is a disproof.
+                    bool is_lost = result != GameResult::Draw || is_attacker;
+                    phi = is_lost ? PN_INFINITY : 0;
+                    delta = is_lost ? 0 : PN_INFINITY;
+                    return;
+                }
+                if (depth == 0) {
+                    // The defender is not mated in time.
+                    phi = 0;
+                    delta = PN_INFINITY;
+                    return;
+                }
+
+                std::vector<Board> children(moves.size(), board);
+                std::vector<uint32_t> children_phi(moves.size(), 1);
+                std::vector<uint32_t> children_delta(moves.size(), 1);
+                for (size_t i = 0; i < moves.size(); i++) {
+                    children[i].PlayMove(moves[i]);
+                    children[i].Mirror();
+                    if (const Entry* entry = table_.Find(children[i].GetZobristKey(), depth - 1)) {
+                        children_phi[i] = is_attacker ? entry->dn : entry->pn;
+                        children_delta[i] = is_attacker ? entry->pn : entry->dn;
+                    }
+                }
+
+                size_t best = 0;
+                while (true) {
+                    phi = PN_INFINITY;
+                    delta = 0;
+                    uint32_t second_delta = PN_INFINITY;
+                    for (size_t i = 0; i < moves.size(); i++) {
+                        delta = Add(delta, children_phi[i]);
+                        if (children_delta[i] < phi) {
+                            second_delta = phi;
+                            phi = children_delta[i];
+                            best = i;
+                        } else if (children_delta[i] < second_delta) {
+                            second_delta = children_delta[i];
+                        }
+                    }
+                    if (phi >= th_phi || delta >= th_delta || (max_nodes_ && nodes_ >= max_nodes_))
+                        break;
+
+                    // The child is searched until it would no longer be the best one or the node exceeds its thresholds.
+                    uint32_t child_th_phi = std::min<uint64_t>(uint64_t(th_delta) + children_phi[best] - delta, PN_INFINITY);
+                    uint32_t child_th_delta = std::min(th_phi, Add(second_delta, 1));
+                    // Siblings played after it overwrote its ply of the history.
+                    History::Instance().AddState(children[best].GetPlyCounter(), children[best].GetZobristKey());
+                    MID(children[best], depth - 1, child_th_phi, child_th_delta, children_phi[best], children_delta[best]);
+                }
+
+                table_.Store(board.GetZobristKey(), depth, is_attacker ? phi : delta, is_attacker ? delta : phi, moves[best]);
+            }
+
+            // Follows the stored moves of the proven nodes.
+            std::vector<Move> Line(Board board, int depth) const {
+                std::vector<Move> line;
+                for (; depth > 0; depth--) {
+                    const Entry* entry = table_.Find(board.GetZobristKey(), depth);
+                    Move move;
+                    if (!entry || entry->pn != 0 || !board.FindLegalMove(entry->move, move))
+                        break;
+                    line.push_back(move);
+                    board.PlayMove(move);
+                    board.Mirror();
+                }
+                return line;
+            }
+
+            uint64_t Nodes() const { return nodes_; }
+
+        private:
+            Table table_;
+            uint64_t nodes_ = 0;
+            uint64_t max_nodes_;
+        };
+    }
+
+    int FindMate(const Board& board, int moves, std::vector<Move>& line, uint64_t max_nodes, Stats* stats) {
+        auto start = std::chrono::steady_clock::now();
+        Solver solver(max_nodes);
+        // The history of the board's ply is rewritten by its children's siblings.
+        History history = History::Instance();
+        // Shorter mates first so the mate is a shortest one , the table is kept between the lengths.
+        int mate_length = 0;
+        for (int length = 1; length <= std::clamp(moves, 1, PN_MAX_MOVES); length++) {
+            uint32_t phi, delta;
+            solver.MID(board, 2 * length - 1, PN_INFINITY, PN_INFINITY, phi, delta);
+            if (phi == 0)
+                mate_length = length;
+            if (phi == 0 || delta != 0)
+                break;
+        }
+        History::Instance() = history;
+
+        line.clear();
+        if (mate_length)
+            line = solver.Line(board, 2 * mate_length - 1);
+        if (stats) {
+            stats->nodes = solver.Nodes();
+            stats->time_ms = int(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+        return mate_length;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef PROOFNUMBER_H
+#define PROOFNUMBER_H
+
+// Memory of the node table of a mate search.
+#define PN_TABLE_MB 64
+// Longest mate searched , its plies must fit the table entries.
+#define PN_MAX_MOVES 127
+
+#include <vector>
+
+#include <representation/Board.h>
+
+namespace ChessEngine::ProofNumber {
+    struct Stats{
+        uint64_t nodes = 0;
+        int time_ms = 0;
+    };
+
+    // Depth first proof number search (df-pn) for a mate of the side to move in at most [moves] moves (up to
+    // PN_MAX_MOVES) , the lengths are tried in increasing order so the mate is a shortest one.
+    // Only the legal moves and Board::Result are used , nothing is evaluated or pruned. Returns the moves of
+    // the proven mate, 0 if none. Gives up after [max_nodes] nodes unless 0.
+    // The mating [line] is read back from the node table and stops early if some of its nodes were replaced.
+    int FindMate(const Board& board, int moves, std::vector<Move>& line, uint64_t max_nodes = 0, Stats* stats = nullptr);
+}
+
+#endif
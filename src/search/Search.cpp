@@ -4,12 +4,13 @@
 
 #include <search/NNUE.h>
 #include <search/TranspositionTable.h>
+#include <search/ZobristKey.h>
 
 namespace ChessEngine {
 
     TranspositionTable transposition_table;
 
-    int search_nodes = 0;
+    thread_local int search_nodes = 0;
 
     static int GetMVVScore(const PieceType& own_type, const PieceType& enemy_type){
         int base_score = 0;
@@ -31,7 +32,7 @@ namespace ChessEngine {
                 base_score = 200;
                 break;
             case Pawn:
-            case None: // Only sorts captures . so none means en passant.
+            case None: // Only sorts captures , en passant carries the pawn.
                 base_score = 100;
                 break;
         }
@@ -64,16 +65,10 @@ namespace ChessEngine {
         return base_score;
     }
 
-    void SortMoves(const Board& board, MoveList& moves){
-        auto move_score = [=] (const Move& move){
-            PieceType type_own, type_enemy;
-            {
-                auto[file_from, rank_from] = move.GetFrom().GetCoords();
-                type_own = board.GetPieceTypeAt(file_from, rank_from);
-                auto[file_to, rank_to] = move.GetTo().GetCoords();
-                type_enemy = board.GetPieceTypeAt(file_to, rank_to);
-            }
-            return GetMVVScore(type_own, type_enemy);
+    void SortMoves(MoveList& moves){
+        // The moved and captured pieces are part of the move.
+        auto move_score = [] (const Move& move){
+            return GetMVVScore(move.GetMovedPiece(), move.GetCapturedPiece());
         };
 
         std::stable_sort(moves.begin(), moves.end(), [=](const Move& mv1, const Move& mv2){
@@ -97,10 +92,10 @@ namespace ChessEngine {
         if(best_score > a)
             a = best_score;
 
-        Bitboard pins = board.GetPins();
-        bool is_in_check = board.IsInCheck();
-        MoveList moves = board.GetLegalCaptures(pins, is_in_check);
-        SortMoves(board, moves);
+        MoveList moves;
+        moves.reserve(20);
+        board.GenerateMoves<GenType::Captures>(moves);
+        SortMoves(moves);
 
         for (const auto& move : moves) {
             // Only capture moves.
@@ -123,22 +118,29 @@ namespace ChessEngine {
     int PVSearch(const Board& board, int depth, int ply, int a, int b, Move& best_move, bool do_null) {
         search_nodes++;
 
+        // A draw by repetition can be forced , the score is at least a draw.
+        if(ply != 0 && a < 0 && board.HasUpcomingRepetition(ply)){
+            a = 0;
+            if(a >= b)
+                return a;
+        }
+
         if (depth <= 0) {
             return QSearch(board, a, b);
         }
 
         bool is_in_check = board.IsInCheck();
-        Bitboard pins = board.GetPins();
 
         // Check extension.
         //if(is_in_check)
             //depth++;
 
-        // Move ordering.
-        MoveList moves = board.GetLegalCaptures(pins, is_in_check);
-        SortMoves(board, moves);
-        MoveList quiet_moves = board.GetLegalQuietMoves(pins, is_in_check);
-        moves.insert(moves.end(), quiet_moves.begin(), quiet_moves.end());
+        // Move ordering. Sorted captures first , the quiet moves are appended after them.
+        MoveList moves;
+        moves.reserve(80);
+        board.GenerateMoves<GenType::Captures>(moves);
+        SortMoves(moves);
+        board.GenerateMoves<GenType::Quiets>(moves);
 
         // Draw / Checkmate detection.
         GameResult game_result = board.Result(moves);
@@ -157,7 +159,15 @@ namespace ChessEngine {
                 break;
         }
 
+#ifdef CANONICAL_TT_KEYS
+        // Colour flipped and reflected positions share their entries , the moves are stored as
+        // the position of the key plays them.
+        bool is_reflected;
+        uint64_t zobrist_key = Zobrist::GetCanonicalKey(board, is_reflected);
+#else
         uint64_t zobrist_key = board.GetZobristKey();
+        bool is_reflected = false;
+#endif
         bool is_root = ply == 0;
         bool is_pv_node = b - a != 1;
 
@@ -178,8 +188,10 @@ namespace ChessEngine {
         if(entry_found) {
             // TT's move can be invalid if it was never set. This case isnt troublesome since
             // it will not be found in the legal moves list.
-            Move tt_move = entry_result.best_move;
-            auto pivot = std::find(moves.begin(), moves.end(), tt_move);
+            uint16_t tt_move = is_reflected ? Move(entry_result.best_move).Reflected().Compress() : entry_result.best_move;
+            auto pivot = std::find_if(moves.begin(), moves.end(), [=](const Move& move) {
+                return move.Compress() == tt_move;
+            });
             if (pivot != moves.end()) {
                 std::rotate(moves.begin(), pivot, pivot + 1);
             }
@@ -225,14 +237,12 @@ namespace ChessEngine {
         int best_score = INT32_MIN;
         for (const auto& move : moves) {
             moves_played++;
-            Board new_board = Board(board);
-            new_board.PlayMove(move);
-            new_board.Mirror();
 
+            // Pruned moves are tested from the current position and never played.
             // Late move pruning.
             static int late_move_pruning_margins[] = {0, 8, 12, 24};
             if(depth <= 3 && !is_pv_node && !is_in_check && moves_played > late_move_pruning_margins[depth]){
-                bool tactical = new_board.IsInCheck() || move.GetPromotion() != None;
+                bool tactical = move.GetPromotion() != None || board.GivesCheck(move);
                 if(!tactical){
                     continue;
                 }
@@ -240,13 +250,16 @@ namespace ChessEngine {
 
             // Futility pruning.
             if(can_futility_prune && moves_played > 1){
-                bool tactical = new_board.IsInCheck() || move.GetPromotion() != None ||
-                        board.GetRepresentation().enemy_pieces.Get(move.GetTo());
+                bool tactical = move.GetPromotion() != None || move.IsCapture() || board.GivesCheck(move);
                 if(!tactical){
                     continue;
                 }
             }
 
+            Board new_board = Board(board);
+            new_board.PlayMove(move);
+            new_board.Mirror();
+
             int score;
             if (pv_search) {
                 score = -PVSearch(new_board, depth - 1, ply + 1, -b, -a, best_move, true);
@@ -276,7 +289,8 @@ namespace ChessEngine {
         }
 
         // Add entry to TT.
-        auto entry = TranspositionTable::TTEntry(depth, best_score, node_type, current_best_move);
+        auto entry = TranspositionTable::TTEntry(depth, best_score, node_type,
+                                                 is_reflected ? current_best_move.Reflected() : current_best_move);
         transposition_table.AddEntry(zobrist_key, entry);
         return best_score;
     }
@@ -317,12 +331,7 @@ namespace ChessEngine {
         if (depth == 0)
             return 1ULL;
 
-        Bitboard pins = board.GetPins();
-        bool is_in_check = board.IsInCheck();
-        MoveList moves = board.GetLegalCaptures(pins, is_in_check);
-        MoveList quiet_moves = board.GetLegalQuietMoves(pins, is_in_check);
-        moves.insert( moves.end(), quiet_moves.begin(), quiet_moves.end());
-        for (const Move& move : moves) {
+        for (const Move& move : board.GetLegalMoves()) {
             Board temp = board;
             temp.PlayMove(move);
             temp.Mirror();
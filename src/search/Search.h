@@ -6,6 +6,8 @@
 namespace ChessEngine {
 
     Move GetBestMove(const Board& board, int depth, int& eval_result);
+    // Captures only search , relative to the side to move.
+    int QSearch(const Board& board, int a, int b);
     int Perft(const Board& board, int depth);
 
 }
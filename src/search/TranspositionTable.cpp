@@ -7,7 +7,7 @@ namespace ChessEngine{
         this->evaluation = evaluation;
         this->depth = depth;
         this->type = type;
-        this->best_move = best_move;
+        this->best_move = best_move.Compress();
     }
 
     void TranspositionTable::AddEntry(uint64_t zobrist_key, const TTEntry& entry){
@@ -17,7 +17,7 @@ namespace ChessEngine{
             NodeType type; // Determines if we check a,b or just return.
             int evaluation; // Position evaluation.
             uint8_t depth; // depth of search's iteration.
-            Move best_move; // Picked move on said search's node.
+            uint16_t best_move; // Picked move on said search's node. Compressed , see Move::Compress.
 
             TTEntry(uint8_t depth, int evaluation, NodeType, Move best_move = Move());
             TTEntry() = default;
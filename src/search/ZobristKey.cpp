@@ -1,5 +1,7 @@
 #include "ZobristKey.h"
 
+#include <representation/AttackTables.h>
+
 #include <random>
 
 namespace ChessEngine::Zobrist {
@@ -8,6 +10,61 @@ namespace ChessEngine::Zobrist {
     static uint64_t castling_key[16];
     static uint64_t black_side_key;
 
+    // Cuckoo tables of the reversible moves, every move is stored at one of its two hashes.
+    #define CUCKOO_SIZE 8192
+    struct CuckooEntry {
+        uint64_t key = 0;
+        PieceType type = None;
+        uint8_t from = 0;
+        uint8_t to = 0;
+    };
+    static CuckooEntry cuckoo[CUCKOO_SIZE];
+
+    namespace {
+        inline int H1(uint64_t key) { return key & (CUCKOO_SIZE - 1); }
+        inline int H2(uint64_t key) { return (key >> 16) & (CUCKOO_SIZE - 1); }
+
+        Bitboard EmptyBoardAttacks(PieceType type, uint8_t tile_index){
+            switch (type) {
+                case Knight: return AttackTables::KnightAttacks(tile_index);
+                case Bishop: return AttackTables::BishopAttacks(tile_index);
+                case Rook: return AttackTables::RookAttacks(tile_index);
+                case Queen: return AttackTables::QueenAttacks(tile_index);
+                case King: return AttackTables::KingAttacks(tile_index);
+                default: return Bitboard();
+            }
+        }
+
+        void InitCuckooTables(){
+            std::fill(std::begin(cuckoo), std::end(cuckoo), CuckooEntry());
+            [[maybe_unused]] int count = 0;
+            for (bool is_white : {true, false}) {
+                for (PieceType type : {Knight, Bishop, Rook, Queen, King}) {
+                    for (uint8_t from = 0; from < 64; from++) {
+                        for (uint8_t to = from + 1; to < 64; to++) {
+                            if(!EmptyBoardAttacks(type, from).Get(to))
+                                continue;
+
+                            CuckooEntry entry = {.key = GetPieceSquareKey(type, is_white, from)
+                                    ^ GetPieceSquareKey(type, is_white, to) ^ GetSideKey(),
+                                    .type = type, .from = from, .to = to};
+                            // Swap the entry in, and move the one it replaces to its other slot until a free one is found.
+                            int index = H1(entry.key);
+                            while (true) {
+                                std::swap(cuckoo[index], entry);
+                                if(entry.type == None)
+                                    break;
+                                index = index == H1(entry.key) ? H2(entry.key) : H1(entry.key);
+                            }
+                            count++;
+                        }
+                    }
+                }
+            }
+            assert(count == 3668);
+        }
+    }
+
     uint64_t GetPieceSquareKey(PieceType type, bool is_white, uint8_t tile_index){
         assert(type != None);
         // We subtract one to exclude none type.
@@ -29,6 +86,19 @@ namespace ChessEngine::Zobrist {
         return black_side_key;
     }
 
+    bool GetReversibleMove(uint64_t key_difference, PieceType& type, uint8_t& from, uint8_t& to){
+        const CuckooEntry* entry = &cuckoo[H1(key_difference)];
+        if(entry->key != key_difference)
+            entry = &cuckoo[H2(key_difference)];
+        if(entry->key != key_difference || entry->type == None)
+            return false;
+
+        type = entry->type;
+        from = entry->from;
+        to = entry->to;
+        return true;
+    }
+
     void InitZobristKeysArrays(){
         std::random_device rd;
         std::mt19937_64 e2(rd());
@@ -50,6 +120,8 @@ namespace ChessEngine::Zobrist {
         }
 
         black_side_key = rand64();
+
+        InitCuckooTables();
     }
 
     uint64_t GetZobristKey(Board board, bool is_flipped) {
@@ -89,4 +161,40 @@ namespace ChessEngine::Zobrist {
         return key;
     }
 
+    uint64_t GetCanonicalKey(const Board& board, bool& reflected){
+        const Board::Representation& rep = board.GetRepresentation();
+        const Board::CastlingRights& rights = board.GetCastlingRights();
+
+        uint64_t key = 0;
+        uint64_t reflected_key = 0;
+        auto update_key = [&] (Bitboard piece_board, PieceType type){
+            for (auto piece : piece_board) {
+                bool is_own = rep.own_pieces.Get(piece);
+                key ^= GetPieceSquareKey(type, is_own, piece.GetIndex());
+                reflected_key ^= GetPieceSquareKey(type, is_own, piece.GetIndex() ^ 0b111);
+            }
+        };
+
+        update_key(rep.Pawns(), PieceType::Pawn);
+        update_key(rep.Knights(), PieceType::Knight);
+        update_key(rep.Bishops(), PieceType::Bishop);
+        update_key(rep.Rooks(), PieceType::Rook);
+        update_key(rep.Queens(), PieceType::Queen);
+        update_key(rep.Kings(), PieceType::King);
+
+        if(!rep.EnPassant().IsEmpty()) {
+            uint8_t file = rep.EnPassant().BitScanForward().GetFile();
+            key ^= GetEnPassantKey(file);
+            reflected_key ^= GetEnPassantKey(7 - file);
+        }
+
+        // Rights are already relative to the side to move. Castling is not symmetric.
+        reflected = false;
+        if(rights.AsInt() != 0)
+            return key ^ GetCastlingKey(rights, false);
+
+        reflected = reflected_key < key;
+        return reflected ? reflected_key : key;
+    }
+
 }
\ No newline at end of file
@@ -9,9 +9,17 @@ namespace ChessEngine::Zobrist {
     uint64_t GetEnPassantKey(uint8_t tile_file);
     uint64_t GetCastlingKey(Board::CastlingRights rights, bool is_flipped);
     uint64_t GetSideKey();
+    // Finds the reversible move (no pawn, capture or castling) whose key difference, including the
+    // change of side, is the given one. Tiles are absolute, from is lower than to.
+    bool GetReversibleMove(uint64_t key_difference, PieceType& type, uint8_t& from, uint8_t& to);
 
     void InitZobristKeysArrays();
     uint64_t GetZobristKey(Board board, bool is_flipped);
+    // Key of the position as the side to move sees it , own pieces are hashed as white on the tiles
+    // of the mirrored board. A position and its colour flipped twin share it. Without castling rights
+    // a position and its file reflection are the same too, the lowest of both keys is returned and
+    // [reflected] tells if it is the one of the reflection (moves have to be reflected as well).
+    uint64_t GetCanonicalKey(const Board& board, bool& reflected);
 }
 
 #endif